@@ -0,0 +1,278 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <optional>
+#include <filesystem>
+#include <system_error>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <utility>
+#include <algorithm>
+#include "mapped_file.h"
+
+// On-disk cache of intermediate and final solver results, for repeated runs on the same input.
+//
+// An entry is identified by a kind (e.g. "distance_table") and a 64 bit key,
+// which is a hash of the input file contents and every parameter the result depends on.
+// Editing the input file or changing a parameter changes the key, so stale entries are never read.
+//
+// Each entry is one file "<kind>-<key in hex>.bin" in the cache directory :
+//   Header
+//   payload written by Writer (values and vectors of trivially copyable types, in order)
+// Entries are read back through a memory mapping, so loading costs little more than copying the payload.
+namespace cache
+{
+// Incremental 64 bit FNV-1a hash.
+class Hasher
+{
+public:
+	Hasher& add(const void* data, size_t size)
+	{
+		auto bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			value ^= bytes[i];
+			value *= PRIME;
+		}
+		return *this;
+	}
+
+	template<typename T>
+	Hasher& add(const T& data)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "only raw values can be hashed");
+		return add(&data, sizeof(T));
+	}
+
+	Hasher& add(const std::string& data)
+	{
+		add(data.size());
+		return add(data.data(), data.size());
+	}
+
+	// Hash the contents of a file. Returns false if the file can't be read.
+	bool add_file(const std::string& file_name)
+	{
+		auto error = std::error_code();
+		auto size = std::filesystem::file_size(file_name, error);
+		if (error)
+			return false;
+
+		auto region = MappedRegion(file_name, 0, static_cast<size_t>(size));
+		if (!region.is_valid())
+			return false;
+		add(size);
+		add(region.data(), static_cast<size_t>(size));
+		return true;
+	}
+
+	std::uint64_t digest() const
+	{
+		return value;
+	}
+
+private:
+	static constexpr std::uint64_t OFFSET_BASIS = 0xcbf29ce484222325ull;
+	static constexpr std::uint64_t PRIME = 0x100000001b3ull;
+
+	std::uint64_t value = OFFSET_BASIS;
+};
+
+// Serializes the payload of an entry.
+class Writer
+{
+public:
+	template<typename T>
+	void write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "only raw values can be stored");
+		auto bytes = reinterpret_cast<const char*>(&value);
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+	template<typename T>
+	void write(const std::vector<T>& values)
+	{
+		write(static_cast<std::uint64_t>(values.size()));
+		if constexpr (std::is_trivially_copyable_v<T>)
+		{
+			auto bytes = reinterpret_cast<const char*>(values.data());
+			buffer.insert(buffer.end(), bytes, bytes + sizeof(T) * values.size());
+		}
+		else
+		{
+			for (const auto& value : values)
+				write(value);
+		}
+	}
+
+	void write(const std::string& value)
+	{
+		write(std::vector<char>(value.begin(), value.end()));
+	}
+
+	const std::vector<char>& bytes() const
+	{
+		return buffer;
+	}
+
+private:
+	std::vector<char> buffer;
+};
+
+// Reads the payload of a mapped entry in the order it was written.
+// Every read returns false instead of reading past the end of a truncated entry.
+class Reader
+{
+public:
+	Reader(MappedRegion region, size_t offset, size_t size)
+		: region(std::move(region)), position(offset), end(offset + size)
+	{}
+
+	template<typename T>
+	bool read(T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "only raw values can be loaded");
+		if (end - position < sizeof(T))
+			return false;
+		std::memcpy(&value, region.data() + position, sizeof(T));
+		position += sizeof(T);
+		return true;
+	}
+
+	template<typename T>
+	bool read(std::vector<T>& values)
+	{
+		auto count = std::uint64_t(0);
+		if (!read(count))
+			return false;
+
+		if constexpr (std::is_trivially_copyable_v<T>)
+		{
+			if ((end - position) / sizeof(T) < count)
+				return false;
+			values.resize(static_cast<size_t>(count));
+			std::memcpy(values.data(), region.data() + position, sizeof(T) * values.size());
+			position += sizeof(T) * values.size();
+			return true;
+		}
+		else
+		{
+			values.clear();
+			values.resize(static_cast<size_t>(std::min<std::uint64_t>(count, end - position)));
+			if (values.size() != count)
+				return false;
+			for (auto& value : values)
+				if (!read(value))
+					return false;
+			return true;
+		}
+	}
+
+	bool read(std::string& value)
+	{
+		auto characters = std::vector<char>();
+		if (!read(characters))
+			return false;
+		value.assign(characters.begin(), characters.end());
+		return true;
+	}
+
+private:
+	MappedRegion region;
+	size_t position;
+	size_t end;
+};
+
+class Cache
+{
+public:
+	// Empty directory disables the cache : load() always misses and store() does nothing.
+	Cache(const std::string& directory = "")
+		: directory(directory)
+	{}
+
+	bool enabled() const
+	{
+		return !directory.empty();
+	}
+
+	std::optional<Reader> load(const std::string& kind, std::uint64_t key) const
+	{
+		if (!enabled())
+			return std::nullopt;
+
+		auto file_name = path(kind, key);
+		auto error = std::error_code();
+		auto size = std::filesystem::file_size(file_name, error);
+		if (error || size < sizeof(Header))
+			return std::nullopt;
+
+		auto region = MappedRegion(file_name, 0, static_cast<size_t>(size));
+		if (!region.is_valid())
+			return std::nullopt;
+
+		auto header = Header();
+		std::memcpy(&header, region.data(), sizeof(Header));
+		if (header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.key != key
+			|| header.payload_size != size - sizeof(Header))
+			return std::nullopt;
+
+		return Reader(std::move(region), sizeof(Header), static_cast<size_t>(header.payload_size));
+	}
+
+	// The entry is written to a temporary file and renamed,
+	// so a concurrent or interrupted run never sees a partial entry.
+	void store(const std::string& kind, std::uint64_t key, const Writer& payload) const
+	{
+		if (!enabled())
+			return;
+
+		auto error = std::error_code();
+		std::filesystem::create_directories(directory, error);
+
+		auto file_name = path(kind, key);
+		auto temporary_name = file_name + ".tmp";
+		{
+			auto output = std::ofstream(temporary_name, std::ios::binary);
+			auto header = Header{ FILE_MAGIC, FILE_VERSION, key, payload.bytes().size() };
+			output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			output.write(payload.bytes().data(), payload.bytes().size());
+			if (!output)
+			{
+				output.close();
+				std::remove(temporary_name.c_str());
+				return;
+			}
+		}
+		std::filesystem::rename(temporary_name, file_name, error);
+		if (error)
+			std::remove(temporary_name.c_str());
+	}
+
+private:
+	struct Header
+	{
+		std::uint32_t magic;
+		// Incremented whenever the payload layout of any kind changes.
+		std::uint32_t version;
+		std::uint64_t key;
+		std::uint64_t payload_size;
+	};
+
+	static constexpr std::uint32_t FILE_MAGIC = 0x48434143; // "CACH"
+	static constexpr std::uint32_t FILE_VERSION = 1;
+
+	std::string path(const std::string& kind, std::uint64_t key) const
+	{
+		char hex[17];
+		std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+		return (std::filesystem::path(directory) / (kind + "-" + hex + ".bin")).string();
+	}
+
+	std::string directory;
+};
+}
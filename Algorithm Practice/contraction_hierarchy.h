@@ -0,0 +1,554 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <cstdint>
+#include "dijkstra.h"
+
+namespace shortest_path
+{
+// Contraction hierarchy for repeated shortest path queries on a static graph.
+//
+// Preprocessing removes ("contracts") vertices one by one in order of importance.
+// When a vertex v is contracted, a shortcut u->w with weight (u->v) + (v->w) is inserted between its neighbors
+// unless a path from u to w not passing through v is just as short (witness path).
+// The remaining graph therefore keeps every shortest path weight between remaining vertices.
+//
+// Every edge and shortcut then goes from a lower rank (contracted earlier) vertex to a higher rank one or the opposite way,
+// and any shortest path can be represented as an upward part followed by a downward part.
+// A query runs dijkstra upward from source on the forward edges and upward from target on the reversed edges,
+// which only explores a tiny portion of the graph.
+//
+// Vertex priority is the edge difference (shortcuts added - edges removed) plus the number of already contracted neighbors,
+// which keeps the hierarchy balanced. Each round contracts a set of vertices which have smaller priority than all of their neighbors.
+// Such vertices are independent of each other, so their witness searches are done in parallel.
+// Priorities are updated lazily : contracting a vertex only marks its neighbors outdated,
+// and an outdated priority is recomputed when the vertex is about to be selected.
+//
+// The remaining graph becomes dense at some point. Contraction stops there, and the remaining vertices (core)
+// keep their edges in both directions. Queries then run in two phases (see distance()) : upward searches that stop at the core,
+// and a bidirectional dijkstra inside the core that starts from every core vertex the upward searches reached.
+//
+// Graphs without hierarchical structure (e.g. random graphs) become dense while most of their vertices remain,
+// and searching such a core is slower than searching the original graph.
+// The hierarchy then falls back to the original graph as a whole core, i.e. distance() is plain bidirectional dijkstra
+// (see has_hierarchy()).
+class ContractionHierarchy
+{
+public:
+	ContractionHierarchy() = default;
+
+	ContractionHierarchy(const std::vector<std::vector<Edge>>& edges, int num_threads)
+		: num_vertices(static_cast<int>(edges.size()))
+	{
+		PROFILE_SCOPE("shortest_path::contract");
+		build(edges, num_threads);
+		prepare_query();
+	}
+
+	// Binary file layout : magic, num_vertices, graph_hash, upward graph, downward graph (see CsrGraph::write()),
+	// number of core vertices, core vertices.
+	// graph_hash is a 64 bit hash of the input the graph was read from.
+	void save(const std::string& file_name, std::uint64_t graph_hash) const
+	{
+		auto output = std::ofstream(file_name, std::ios::binary);
+		int header[2] = { FILE_MAGIC, num_vertices };
+		output.write(reinterpret_cast<const char*>(header), sizeof(header));
+		output.write(reinterpret_cast<const char*>(&graph_hash), sizeof(graph_hash));
+		upward.write(output);
+		downward.write(output);
+
+		auto core_vertices = std::vector<int>();
+		for (int vertex = 0; vertex < num_vertices; ++vertex)
+			if (core[vertex])
+				core_vertices.push_back(vertex);
+		auto num_core = static_cast<int>(core_vertices.size());
+		output.write(reinterpret_cast<const char*>(&num_core), sizeof(num_core));
+		output.write(reinterpret_cast<const char*>(core_vertices.data()), sizeof(int) * core_vertices.size());
+	}
+
+	// Returns false if the file doesn't exist, is corrupt,
+	// or was built for a different graph (other graph_hash or number of vertices).
+	bool load(const std::string& file_name, int expected_vertices, std::uint64_t graph_hash)
+	{
+		auto input = std::ifstream(file_name, std::ios::binary);
+		int header[2] = { 0, 0 };
+		auto stored_hash = std::uint64_t(0);
+		if (!input.read(reinterpret_cast<char*>(header), sizeof(header))
+			|| header[0] != FILE_MAGIC || header[1] != expected_vertices
+			|| !input.read(reinterpret_cast<char*>(&stored_hash), sizeof(stored_hash)) || stored_hash != graph_hash)
+			return false;
+
+		num_vertices = header[1];
+		if (!upward.read(input) || !downward.read(input) || upward.size() != num_vertices || downward.size() != num_vertices)
+			return false;
+
+		auto num_core = 0;
+		if (!input.read(reinterpret_cast<char*>(&num_core), sizeof(num_core)) || num_core < 0 || num_core > num_vertices)
+			return false;
+		auto core_vertices = std::vector<int>(num_core);
+		if (!input.read(reinterpret_cast<char*>(core_vertices.data()), sizeof(int) * core_vertices.size()))
+			return false;
+		core.assign(num_vertices, false);
+		for (auto vertex : core_vertices)
+		{
+			if (vertex < 0 || vertex >= num_vertices)
+				return false;
+			core[vertex] = true;
+		}
+
+		prepare_query();
+		return true;
+	}
+
+	// False if contraction was given up (see above) and queries run bidirectional dijkstra on the original graph.
+	bool has_hierarchy() const
+	{
+		return std::find(core.begin(), core.end(), false) != core.end();
+	}
+
+	// Shortest path weight from source to target (INFINITE if unreachable).
+	// 1. Upward searches from source (on upward edges) and from target (on downward edges).
+	//    Vertices are ranked outside the core, so each search only stops once its queue top
+	//    is not shorter than the best meeting point found so far. Core vertices are reached but not expanded.
+	// 2. Bidirectional dijkstra inside the core, starting from every core vertex reached by each side with its upward path weight.
+	//    Core vertices have no rank, so this phase uses the usual bidirectional stopping rule
+	//    (the sum of both queue tops reaches the best path) instead of searching the core from both sides completely.
+	int distance(int source, int target)
+	{
+		auto best = source == target ? 0 : INFINITE;
+		MinQueue forward_core, backward_core;
+		search_upward(source, upward, forward_weight, backward_weight, forward_core, best);
+		search_upward(target, downward, backward_weight, forward_weight, backward_core, best);
+
+		while (!forward_core.empty() && !backward_core.empty()
+			&& add_weight(forward_core.top().first, backward_core.top().first) < best)
+		{
+			if (forward_core.top().first <= backward_core.top().first)
+				search_core(forward_core, upward, forward_weight, backward_weight, best);
+			else
+				search_core(backward_core, downward, backward_weight, forward_weight, best);
+		}
+
+		for (auto vertex : touched)
+		{
+			forward_weight[vertex] = INFINITE;
+			backward_weight[vertex] = INFINITE;
+		}
+		touched.clear();
+
+		return best;
+	}
+
+private:
+	// "CH3". Older files ("CH" without graph_hash, "CH2" without core vertices) are rebuilt.
+	static constexpr int FILE_MAGIC = 0x334843;
+
+	// Witness searches of a vertex give up after settling WITNESS_WORK / (in degree * out degree) vertices,
+	// clamped to [WITNESS_MIN_SETTLED, WITNESS_MAX_SETTLED], since a vertex runs one search per incoming edge.
+	// Low degree vertices get long searches that avoid unnecessary shortcuts, and the high degree vertices near the core stay cheap.
+	// Giving up only adds a shortcut that might not be necessary, so the result stays correct.
+	static constexpr int WITNESS_WORK = 2000;
+	static constexpr int WITNESS_MIN_SETTLED = 20;
+	static constexpr int WITNESS_MAX_SETTLED = 1000;
+
+	struct Shortcut
+	{
+		int from;
+		int to;
+		int weight;
+	};
+
+	// Graph of remaining vertices during preprocessing.
+	// incoming[v] lists edges u->v in form {u, weight}.
+	struct Remaining
+	{
+		std::vector<std::vector<Edge>> outgoing;
+		std::vector<std::vector<Edge>> incoming;
+		std::vector<int> contracted;
+
+		// Insert edge from->to, or lower its weight if it already exists.
+		void add_edge(int from, int to, int weight)
+		{
+			auto update = [](std::vector<Edge>& list, int vertex, int weight) {
+				for (auto& edge : list)
+				{
+					if (edge.to == vertex)
+					{
+						edge.weight = std::min(edge.weight, weight);
+						return;
+					}
+				}
+				list.push_back({ vertex, weight });
+			};
+			update(outgoing[from], to, weight);
+			update(incoming[to], from, weight);
+		}
+	};
+
+	// Local dijkstra over the remaining graph, skipping contracted vertices.
+	// Each thread owns one instance, and only touched entries are reset between searches.
+	class WitnessSearch
+	{
+	public:
+		WitnessSearch(int num_vertices)
+			: weight(num_vertices, INFINITE), is_target(num_vertices, false)
+		{}
+
+		// Shortest path weights from source to targets that don't pass through excluded,
+		// exact for every target within limit unless settle_limit vertices are settled first.
+		// The search ends early once every target is settled.
+		void run(const Remaining& graph, int source, int excluded, int limit, int settle_limit, const std::vector<Edge>& targets)
+		{
+			for (auto vertex : touched)
+				weight[vertex] = INFINITE;
+			touched.clear();
+
+			auto unsettled_targets = 0;
+			for (const auto& [target, target_weight] : targets)
+			{
+				unsettled_targets += !is_target[target];
+				is_target[target] = true;
+			}
+
+			// heap is kept as a member so that its storage is reused between searches.
+			heap.clear();
+			weight[source] = 0;
+			touched.push_back(source);
+			heap.push_back({ 0, source });
+
+			auto settled = 0;
+			while (!heap.empty() && settled < settle_limit && unsettled_targets > 0)
+			{
+				std::pop_heap(heap.begin(), heap.end(), std::greater<std::pair<int, int>>());
+				auto [cost, next] = heap.back();
+				heap.pop_back();
+				if (cost > limit)
+					break;
+				if (cost > weight[next])
+					continue;
+				++settled;
+				unsettled_targets -= is_target[next];
+
+				for (const auto& [to, edge_weight] : graph.outgoing[next])
+				{
+					if (to == excluded || graph.contracted[to])
+						continue;
+
+					auto new_weight = cost + edge_weight;
+					if (weight[to] > new_weight)
+					{
+						if (weight[to] == INFINITE)
+							touched.push_back(to);
+						weight[to] = new_weight;
+						heap.push_back({ new_weight, to });
+						std::push_heap(heap.begin(), heap.end(), std::greater<std::pair<int, int>>());
+					}
+				}
+			}
+
+			for (const auto& [target, target_weight] : targets)
+				is_target[target] = false;
+		}
+
+		int operator[](int vertex) const
+		{
+			return weight[vertex];
+		}
+
+	private:
+		std::vector<int> weight;
+		std::vector<int> touched;
+		std::vector<int> is_target;
+		std::vector<std::pair<int, int>> heap;
+	};
+
+	// Contraction stops once the remaining graph has this average out degree.
+	// Contracting vertices of a dense graph mostly adds shortcuts between all pairs of neighbors,
+	// which makes both preprocessing and queries slower than simply searching the remaining core.
+	static constexpr int CORE_AVERAGE_DEGREE = 16;
+
+	// The hierarchy falls back to plain bidirectional dijkstra if the core holds more than 1 / LARGE_CORE_SHARE of the vertices.
+	// Contraction is also given up early once the remaining graph is half as dense as a core while a quarter of the vertices remain,
+	// which random graphs reach after a few rounds, whereas road-like graphs have only a few percent of their vertices left by then.
+	static constexpr int LARGE_CORE_SHARE = 10;
+
+	static bool is_denser(const Remaining& graph, const std::vector<int>& remaining, int average_degree)
+	{
+		size_t num_edges = 0;
+		for (auto vertex : remaining)
+			num_edges += graph.outgoing[vertex].size();
+		return num_edges > remaining.size() * average_degree;
+	}
+
+	// Shortcuts required to contract vertex.
+	static std::vector<Shortcut> find_shortcuts(const Remaining& graph, WitnessSearch& search, int vertex)
+	{
+		auto result = std::vector<Shortcut>();
+		auto num_pairs = static_cast<int>(std::max<size_t>(1, graph.incoming[vertex].size() * graph.outgoing[vertex].size()));
+		auto settle_limit = std::clamp(WITNESS_WORK / num_pairs, WITNESS_MIN_SETTLED, WITNESS_MAX_SETTLED);
+
+		auto max_outgoing = 0;
+		for (const auto& [to, weight] : graph.outgoing[vertex])
+			max_outgoing = std::max(max_outgoing, weight);
+
+		for (const auto& [from, in_weight] : graph.incoming[vertex])
+		{
+			search.run(graph, from, vertex, in_weight + max_outgoing, settle_limit, graph.outgoing[vertex]);
+			for (const auto& [to, out_weight] : graph.outgoing[vertex])
+			{
+				if (to != from && search[to] > in_weight + out_weight)
+					result.push_back({ from, to, in_weight + out_weight });
+			}
+		}
+
+		return result;
+	}
+
+	void build(const std::vector<std::vector<Edge>>& edges, int num_threads)
+	{
+		auto graph = Remaining{
+			std::vector<std::vector<Edge>>(num_vertices),
+			std::vector<std::vector<Edge>>(num_vertices),
+			std::vector<int>(num_vertices, false)
+		};
+		for (int from = 0; from < num_vertices; ++from)
+			for (const auto& [to, weight] : edges[from])
+				if (from != to)
+					graph.add_edge(from, to, weight);
+
+		auto searches = std::vector<WitnessSearch>(num_threads, WitnessSearch(num_vertices));
+		auto priority = std::vector<int>(num_vertices);
+		auto contracted_neighbors = std::vector<int>(num_vertices, 0);
+		auto update_priority = [&](const std::vector<int>& vertices) {
+			parallel_for(static_cast<int>(vertices.size()), num_threads, [&](int t, int begin, int end) {
+				for (auto i = begin; i < end; ++i)
+				{
+					auto vertex = vertices[i];
+					auto shortcuts = static_cast<int>(find_shortcuts(graph, searches[t], vertex).size());
+					auto removed = static_cast<int>(graph.outgoing[vertex].size() + graph.incoming[vertex].size());
+					priority[vertex] = shortcuts - removed + contracted_neighbors[vertex];
+				}
+				});
+		};
+
+		auto remaining = std::vector<int>(num_vertices);
+		for (int vertex = 0; vertex < num_vertices; ++vertex)
+			remaining[vertex] = vertex;
+		update_priority(remaining);
+		// outdated[v] is true if a neighbor of v was contracted since priority[v] was computed.
+		auto outdated = std::vector<int>(num_vertices, false);
+
+		// true if (priority, index) of vertex is smaller than that of all of its remaining neighbors.
+		auto is_local_minimum = [&](int vertex) {
+			auto smallest = [&](const std::vector<Edge>& neighbors) {
+				for (const auto& [neighbor, weight] : neighbors)
+					if (std::pair{ priority[neighbor], neighbor } < std::pair{ priority[vertex], vertex })
+						return false;
+				return true;
+			};
+			return smallest(graph.outgoing[vertex]) && smallest(graph.incoming[vertex]);
+		};
+
+		auto upward_edges = std::vector<std::vector<Edge>>(num_vertices);
+		auto downward_edges = std::vector<std::vector<Edge>>(num_vertices);
+		while (!remaining.empty() && !is_denser(graph, remaining, CORE_AVERAGE_DEGREE))
+		{
+			// given up early, see LARGE_CORE_SHARE.
+			if (remaining.size() * 4 > static_cast<size_t>(num_vertices) && is_denser(graph, remaining, CORE_AVERAGE_DEGREE / 2))
+				break;
+
+			// local minima are candidates. Outdated priorities of candidates are recomputed,
+			// and the candidates still smaller than all of their neighbors are selected.
+			// A round may select nothing, but the global minimum is selected once its priority is up to date, so contraction always proceeds.
+			auto candidates = std::vector<int>();
+			auto recompute = std::vector<int>();
+			for (auto vertex : remaining)
+			{
+				if (is_local_minimum(vertex))
+				{
+					candidates.push_back(vertex);
+					if (outdated[vertex])
+						recompute.push_back(vertex);
+				}
+			}
+			update_priority(recompute);
+			for (auto vertex : recompute)
+				outdated[vertex] = false;
+
+			auto selected = std::vector<int>();
+			for (auto vertex : candidates)
+				if (is_local_minimum(vertex))
+					selected.push_back(vertex);
+
+			// witness paths must not pass through any vertex contracted in this round,
+			// since those vertices are being removed at the same time.
+			for (auto vertex : selected)
+				graph.contracted[vertex] = true;
+
+			auto shortcuts = std::vector<std::vector<Shortcut>>(selected.size());
+			parallel_for(static_cast<int>(selected.size()), num_threads, [&](int t, int begin, int end) {
+				for (auto i = begin; i < end; ++i)
+				{
+					auto vertex = selected[i];
+					shortcuts[i] = find_shortcuts(graph, searches[t], vertex);
+
+					// every remaining neighbor will be contracted later, i.e. has higher rank.
+					upward_edges[vertex] = graph.outgoing[vertex];
+					downward_edges[vertex] = graph.incoming[vertex];
+				}
+				});
+
+			// remove contracted vertices from the remaining graph and insert shortcuts.
+			auto neighbors = std::vector<int>();
+			for (size_t i = 0; i < selected.size(); ++i)
+			{
+				auto vertex = selected[i];
+				auto erase = [vertex](std::vector<Edge>& list) {
+					list.erase(std::remove_if(list.begin(), list.end(), [vertex](const Edge& edge) {
+						return edge.to == vertex;
+						}), list.end());
+				};
+
+				for (const auto& [to, weight] : graph.outgoing[vertex])
+				{
+					erase(graph.incoming[to]);
+					++contracted_neighbors[to];
+					neighbors.push_back(to);
+				}
+				for (const auto& [from, weight] : graph.incoming[vertex])
+				{
+					erase(graph.outgoing[from]);
+					++contracted_neighbors[from];
+					neighbors.push_back(from);
+				}
+				graph.outgoing[vertex].clear();
+				graph.incoming[vertex].clear();
+
+				for (const auto& [from, to, weight] : shortcuts[i])
+					graph.add_edge(from, to, weight);
+			}
+
+			remaining.erase(std::remove_if(remaining.begin(), remaining.end(), [&](int vertex) {
+				return graph.contracted[vertex];
+				}), remaining.end());
+
+			for (auto vertex : neighbors)
+				outdated[vertex] = true;
+		}
+
+		if (remaining.size() * LARGE_CORE_SHARE > static_cast<size_t>(num_vertices))
+		{
+			// no useful hierarchy : every vertex is in the core with its original edges.
+			core.assign(num_vertices, true);
+			upward = CsrGraph(edges);
+			downward = upward.reverse();
+			return;
+		}
+
+		// vertices left uncontracted form the core, which is searched by bidirectional dijkstra (see distance()).
+		core.assign(num_vertices, false);
+		for (auto vertex : remaining)
+		{
+			upward_edges[vertex] = graph.outgoing[vertex];
+			downward_edges[vertex] = graph.incoming[vertex];
+			core[vertex] = true;
+		}
+
+		upward = CsrGraph(upward_edges);
+		downward = CsrGraph(downward_edges);
+	}
+
+	using MinQueue = std::priority_queue<
+		std::pair<int, int>,
+		std::vector<std::pair<int, int>>,
+		std::greater<std::pair<int, int>>
+	>;
+
+	// Phase 1 of distance() for one side. Core vertices reached are pushed to core_queue instead of being expanded.
+	void search_upward(int from, const CsrGraph& graph, std::vector<int>& weight, const std::vector<int>& other_weight, MinQueue& core_queue, int& best)
+	{
+		MinQueue queue;
+		set_weight(weight, from, 0);
+		queue.push({ 0, from });
+
+		while (!queue.empty() && queue.top().first < best)
+		{
+			auto [cost, next] = queue.top();
+			queue.pop();
+			if (cost > weight[next])
+				continue;
+
+			if (other_weight[next] != INFINITE)
+				best = std::min(best, add_weight(cost, other_weight[next]));
+
+			if (core[next])
+			{
+				core_queue.push({ cost, next });
+				continue;
+			}
+
+			for (const auto& [to, edge_weight] : graph[next])
+			{
+				auto new_weight = add_weight(cost, edge_weight);
+				if (weight[to] > new_weight)
+				{
+					set_weight(weight, to, new_weight);
+					queue.push({ new_weight, to });
+				}
+			}
+		}
+	}
+
+	// One step of phase 2 of distance() : settle the top of queue and relax its core edges.
+	void search_core(MinQueue& queue, const CsrGraph& graph, std::vector<int>& weight, const std::vector<int>& other_weight, int& best)
+	{
+		auto [cost, next] = queue.top();
+		queue.pop();
+		if (cost > weight[next])
+			return;
+
+		for (const auto& [to, edge_weight] : graph[next])
+		{
+			auto new_weight = add_weight(cost, edge_weight);
+			if (weight[to] > new_weight)
+			{
+				set_weight(weight, to, new_weight);
+				queue.push({ new_weight, to });
+				if (other_weight[to] != INFINITE)
+					best = std::min(best, add_weight(new_weight, other_weight[to]));
+			}
+		}
+	}
+
+	void prepare_query()
+	{
+		forward_weight.assign(num_vertices, INFINITE);
+		backward_weight.assign(num_vertices, INFINITE);
+	}
+
+	void set_weight(std::vector<int>& weight, int vertex, int value)
+	{
+		if (forward_weight[vertex] == INFINITE && backward_weight[vertex] == INFINITE)
+			touched.push_back(vertex);
+		weight[vertex] = value;
+	}
+
+	int num_vertices = 0;
+
+	// upward[v] : edges and shortcuts v->w where w has higher rank than v.
+	// downward[v] : edges and shortcuts u->v where u has higher rank than v, stored as {u, weight}.
+	// core vertices have the same rank, i.e. both lists contain all of their remaining edges.
+	CsrGraph upward;
+	CsrGraph downward;
+	// core[v] is true if v was left uncontracted.
+	std::vector<int> core;
+
+	std::vector<int> forward_weight;
+	std::vector<int> backward_weight;
+	std::vector<int> touched;
+};
+
+}
\ No newline at end of file
@@ -1,28 +1,87 @@
 #pragma once
 #include <iostream>
 #include <fstream>
+#include <string>
 #include <queue>
+#include <map>
 #include <vector>
+#include <array>
+#include <algorithm>
 #include <thread>
 #include <future>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <limits>
+#include <type_traits>
+#include <cstdint>
+#include <cassert>
+#include <optional>
+#include "profiling.h"
 
-constexpr int INFINITE = 999999999;
+namespace shortest_path
+{
+// Kernels below are templates on the edge weight type (int32, int64, float or double),
+// so that path weight arrays can use the narrowest type that can't overflow on a given graph.
+
+// Path weight of an unreachable vertex.
+// Infinity for floating point types, largest value for integer types.
+template<typename Weight>
+constexpr Weight infinite()
+{
+	if constexpr (std::numeric_limits<Weight>::has_infinity)
+		return std::numeric_limits<Weight>::infinity();
+	else
+		return std::numeric_limits<Weight>::max();
+}
 
-struct Edge
+// Unreachable path weight of the int weighted structures (CsrGraph and the point to point query engines).
+constexpr int INFINITE = infinite<int>();
+
+// path_weight + edge_weight, saturated to infinite<Weight>() instead of overflowing.
+// Floating point infinity already stays infinite under addition, so only integers need the check.
+template<typename Weight>
+constexpr Weight add_weight(Weight path_weight, Weight edge_weight)
+{
+	if constexpr (std::is_floating_point_v<Weight>)
+		return path_weight + edge_weight;
+	else
+		return path_weight > infinite<Weight>() - edge_weight ? infinite<Weight>() : path_weight + edge_weight;
+}
+
+// Long running solvers stop early when this point in time is passed.
+using Deadline = std::chrono::steady_clock::time_point;
+
+template<typename Weight>
+struct WeightedEdge
 {
 	int to;
-	int weight;
+	Weight weight;
 };
 
-std::vector<int> dijkstra(int num_vertices, int source, const std::vector<std::vector<Edge>>& edges)
+using Edge = WeightedEdge<int>;
+
+// Weight type of the edges in an adjacency structure.
+template<typename AdjacencyList>
+using WeightOf = std::decay_t<decltype(std::declval<const AdjacencyList&>()[0].begin()->weight)>;
+
+template<typename Weight>
+using MinQueue = std::priority_queue<
+	std::pair<Weight, int>,
+	std::vector<std::pair<Weight, int>>,
+	std::greater<std::pair<Weight, int>>
+>;
+
+// "edges" can be any adjacency structure where edges[vertex] is iterable as a list of WeightedEdge,
+// such as std::vector<std::vector<Edge>> or CsrGraph.
+template<typename AdjacencyList, typename Weight = WeightOf<AdjacencyList>>
+std::vector<Weight> dijkstra(int num_vertices, int source, const AdjacencyList& edges)
 {
-	std::vector<int> path_weight(num_vertices, INFINITE);
+	std::vector<Weight> path_weight(num_vertices, infinite<Weight>());
 	std::vector<int> visited(num_vertices, false);
-	std::priority_queue<
-		std::pair<int, int>,
-		std::vector<std::pair<int, int>>,
-		std::greater<std::pair<int, int>>
-	> queue;
+	MinQueue<Weight> queue;
 	queue.push({ 0, source });
 	path_weight[source] = 0;
 
@@ -36,10 +95,12 @@ std::vector<int> dijkstra(int num_vertices, int source, const std::vector<std::v
 
 			for (const auto& [to, weight] : edges[next])
 			{
-				auto new_weight = path_weight[next] + weight;
+				PROFILE_COUNT("shortest_path::relaxations", 1);
+				auto new_weight = add_weight(path_weight[next], weight);
 				if (path_weight[to] > new_weight)
 				{
 					path_weight[to] = new_weight;
+					PROFILE_COUNT("shortest_path::heap_pushes", 1);
 					queue.push({ new_weight, to });
 				}
 			}
@@ -49,76 +110,601 @@ std::vector<int> dijkstra(int num_vertices, int source, const std::vector<std::v
 	return path_weight;
 }
 
-int main()
+// Number of sources advanced together by dijkstra_batch().
+constexpr int BATCH_WIDTH = 8;
+
+// Perform SSSP for BATCH_WIDTH sources at once.
+// Each vertex holds a distance vector with one lane per source, so every adjacency list
+// loaded from memory is used to relax the edges of all sources in the batch.
+// The lane-wise add and min below are plain fixed-size loops, which the compiler turns into SIMD instructions.
+//
+// Since lanes of a vertex can improve at different times, this is a label-correcting variant of dijkstra:
+// a vertex is pushed again whenever any lane improves, keyed by the smallest improved lane,
+// and each pop relaxes every lane of the vertex.
+// The result is identical to calling dijkstra() for each source.
+// (i.e. result[dest][lane] == dijkstra(num_vertices, sources[lane], edges)[dest])
+template<typename Weight>
+std::vector<std::array<Weight, BATCH_WIDTH>> dijkstra_batch(int num_vertices, const std::array<int, BATCH_WIDTH>& sources, const std::vector<std::vector<WeightedEdge<Weight>>>& edges)
+{
+	auto infinite_lanes = std::array<Weight, BATCH_WIDTH>();
+	infinite_lanes.fill(infinite<Weight>());
+
+	std::vector<std::array<Weight, BATCH_WIDTH>> path_weight(num_vertices, infinite_lanes);
+
+	// dirty[v] is true if some lane of v has improved since v was last popped.
+	// Outdated queue entries of a clean vertex are skipped.
+	std::vector<int> dirty(num_vertices, false);
+	MinQueue<Weight> queue;
+
+	for (int lane = 0; lane < BATCH_WIDTH; ++lane)
+	{
+		path_weight[sources[lane]][lane] = 0;
+		if (!dirty[sources[lane]])
+		{
+			dirty[sources[lane]] = true;
+			queue.push({ 0, sources[lane] });
+		}
+	}
+
+	auto candidate = std::array<Weight, BATCH_WIDTH>();
+	while (!queue.empty())
+	{
+		auto [cost, next] = queue.top();
+		queue.pop();
+
+		if (dirty[next]) {
+			dirty[next] = false;
+
+			const auto& current = path_weight[next];
+			for (const auto& [to, weight] : edges[next])
+			{
+				PROFILE_COUNT("shortest_path::batch_relaxations", 1);
+				auto& target = path_weight[to];
+
+				// lane-wise relaxation.
+				// min_improved is the smallest lane value that became shorter (infinite if none).
+				auto min_improved = infinite<Weight>();
+				for (int lane = 0; lane < BATCH_WIDTH; ++lane)
+				{
+					candidate[lane] = add_weight(current[lane], weight);
+					auto improved = candidate[lane] < target[lane];
+					target[lane] = improved ? candidate[lane] : target[lane];
+					min_improved = improved ? std::min(min_improved, candidate[lane]) : min_improved;
+				}
+
+				if (min_improved != infinite<Weight>())
+				{
+					dirty[to] = true;
+					PROFILE_COUNT("shortest_path::heap_pushes", 1);
+					queue.push({ min_improved, to });
+				}
+			}
+		}
+	}
+
+	return path_weight;
+}
+
+// Lower value to new_value if new_value is smaller.
+// Returns true if the value was changed by this call.
+template<typename Weight>
+bool atomic_min(std::atomic<Weight>& value, Weight new_value)
+{
+	auto current = value.load(std::memory_order_relaxed);
+	while (new_value < current)
+	{
+		if (value.compare_exchange_weak(current, new_value, std::memory_order_relaxed))
+			return true;
+	}
+	return false;
+}
+
+// Split [0, count) into num_threads contiguous ranges and call task(thread_index, begin, end) on each of them in parallel.
+// The range split is the same as the one used for sources in longest_shortest_path().
+template<typename Task>
+void parallel_for(int count, int num_threads, const Task& task)
 {
-	std::iostream::sync_with_stdio(false);
+	auto chunk = count / num_threads;
+	if (chunk == 0)
+	{
+		task(0, 0, count);
+		return;
+	}
 
-	// Input file configuration
-	//auto num_vertices = 1000000;
-	//auto input_file = std::ifstream("1000000.graph");
-	//auto num_vertices = 32000;
-	//auto input_file = std::ifstream("32000.graph");
-	auto num_vertices = 16000;
-	auto input_file = std::ifstream("16000.graph");
+	auto results = std::vector<std::future<void>>();
+	for (auto t = 1; t < num_threads; ++t)
+	{
+		auto t_start = chunk * t;
+		auto t_end = t == num_threads - 1 ? count : t_start + chunk;
+		results.emplace_back(std::async(std::launch::async, [&, t, t_start, t_end] {
+			task(t, t_start, t_end);
+			}));
+	}
+	task(0, 0, chunk);
 
-	// Multithreading configuration.
-	// num_groups : number of vertex group to process at one time.
-	// num_threads : number of threads created for each group.
-	// For example, (num_group = 2, num_vertices = 1000, num_threads = 10) means
-	// vertex 0 ~ 999 is divided into two groups 0~499 and 500~999. Each group's vertices
-	// is distibuted to four threads evenly to find the local longest shortest path solution whith that vertex as source node
-	// (e.g. lsp of vertex 0~49 from thread 1, lsp of vertex 50~99 from thread 2, ...)
-	auto num_groups = 1000;
-	auto num_threads = 8;
+	for (auto& result : results)
+		result.get();
+}
 
-	// Contain all directed edge information in form edges[from] = {from->dest1, from->dest2, ...}.
-	// In other words, ith element of edges correspond to list of edges outgoing from ith vertex.
-	auto edges = std::vector<std::vector<Edge>>(num_vertices);
-	while (input_file)
+// Threads kept alive across many short parallel phases.
+// Starting threads with std::async costs more than a small phase itself,
+// so solvers with many phases (e.g. delta_stepping()) create one group and run every phase on it.
+class WorkerGroup
+{
+public:
+	WorkerGroup(int num_threads)
+		: num_threads(std::max(1, num_threads))
 	{
-		int from, to, weight;
-		input_file >> from >> to >> weight;
+		for (auto t = 1; t < this->num_threads; ++t)
+			workers.emplace_back(std::async(std::launch::async, [this, t] {
+				work(t);
+				}));
+	}
+
+	WorkerGroup(const WorkerGroup&) = delete;
+	WorkerGroup& operator=(const WorkerGroup&) = delete;
+
+	~WorkerGroup()
+	{
+		{
+			auto lock = std::lock_guard(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& worker : workers)
+			worker.get();
+	}
+
+	int size() const
+	{
+		return num_threads;
+	}
+
+	// Call task(thread_index) once on every thread of the group, the calling thread being index 0.
+	// Returns after all of them are done.
+	void run(const std::function<void(int)>& task)
+	{
+		{
+			auto lock = std::lock_guard(mutex);
+			current = &task;
+			running = num_threads - 1;
+			++generation;
+		}
+		wake.notify_all();
+		task(0);
+
+		auto lock = std::unique_lock(mutex);
+		done.wait(lock, [&] { return running == 0; });
+	}
+
+private:
+	void work(int t)
+	{
+		auto seen = std::uint64_t(0);
+		while (true)
+		{
+			const std::function<void(int)>* task = nullptr;
+			{
+				auto lock = std::unique_lock(mutex);
+				wake.wait(lock, [&] { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+				task = current;
+			}
+
+			(*task)(t);
+
+			auto lock = std::lock_guard(mutex);
+			if (--running == 0)
+				done.notify_one();
+		}
+	}
+
+	int num_threads;
+	std::vector<std::future<void>> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(int)>* current = nullptr;
+	std::uint64_t generation = 0;
+	int running = 0;
+	bool stopping = false;
+};
+
+// Same as above, but runs on the threads of workers instead of starting new ones.
+template<typename Task>
+void parallel_for(int count, WorkerGroup& workers, const Task& task)
+{
+	auto num_threads = workers.size();
+	auto chunk = count / num_threads;
+	if (chunk == 0)
+	{
+		task(0, 0, count);
+		return;
+	}
+
+	workers.run([&](int t) {
+		auto t_start = chunk * t;
+		auto t_end = t == num_threads - 1 ? count : t_start + chunk;
+		task(t, t_start, t_end);
+		});
+}
+
+// Parallel SSSP using delta-stepping.
+// Vertices are kept in buckets of width delta by their tentative distance (bucket i holds [i * delta, (i + 1) * delta)).
+// Buckets are processed in increasing order:
+// 1. light edges (weight <= delta) of the current bucket are relaxed repeatedly until the bucket stays empty,
+//    since they may insert vertices back into the same bucket.
+// 2. heavy edges (weight > delta) of every vertex removed from the bucket are relaxed once,
+//    since they always land in a later bucket.
+// Each phase splits its vertices among num_threads threads, and relaxation is done with atomic min.
+// The threads are started once and reused by every phase, since a phase is often only a few vertices.
+// Only non-empty buckets are stored (ordered by index), so the next bucket is found directly
+// even when path weights are many bucket widths apart.
+// delta must be positive.
+//
+// Small delta approaches dijkstra (less redundant work, less parallelism)
+// while large delta approaches bellman-ford (more parallelism, more redundant work).
+// Average edge weight is a reasonable starting point (see average_edge_weight()).
+//
+// The output is deterministic; shortest path weights do not depend on the order of relaxations.
+// Frontiers are also sorted before each phase, so the amount of work does not depend on thread timing either.
+template<typename Weight>
+std::vector<Weight> delta_stepping(int num_vertices, int source, const std::vector<std::vector<WeightedEdge<Weight>>>& edges, Weight delta, int num_threads)
+{
+	PROFILE_SCOPE("shortest_path::delta_stepping");
+	assert(delta > Weight(0));
+	auto workers = WorkerGroup(num_threads);
+	auto path_weight = std::vector<std::atomic<Weight>>(num_vertices);
+	for (auto& weight : path_weight)
+		weight.store(infinite<Weight>(), std::memory_order_relaxed);
+
+	auto bucket_of = [&](int vertex) {
+		return static_cast<std::uint64_t>(path_weight[vertex].load(std::memory_order_relaxed) / delta);
+	};
+	auto buckets = std::map<std::uint64_t, std::vector<int>>();
+	auto insert = [&](int vertex) {
+		buckets[bucket_of(vertex)].push_back(vertex);
+	};
+
+	path_weight[source].store(Weight(0), std::memory_order_relaxed);
+	insert(source);
+
+	// updated[t] contains vertices whose path weight was lowered by thread t during a phase.
+	// They are moved into buckets after all threads are done.
+	auto updated = std::vector<std::vector<int>>(workers.size());
+	auto relax = [&](const std::vector<int>& frontier, bool light) {
+		parallel_for(static_cast<int>(frontier.size()), workers, [&](int t, int begin, int end) {
+			for (auto i = begin; i < end; ++i)
+			{
+				auto next = frontier[i];
+				auto current = path_weight[next].load(std::memory_order_relaxed);
+				for (const auto& [to, weight] : edges[next])
+				{
+					PROFILE_COUNT("shortest_path::relaxations", 1);
+					if ((weight <= delta) == light && atomic_min(path_weight[to], add_weight(current, weight)))
+						updated[t].push_back(to);
+				}
+			}
+			});
+
+		for (auto& vertices : updated)
+		{
+			for (auto vertex : vertices)
+				insert(vertex);
+			vertices.clear();
+		}
+	};
+
+	while (!buckets.empty())
+	{
+		// relaxations never reach an earlier bucket, so the smallest stored bucket is the current one until it stays empty.
+		auto bucket = buckets.begin()->first;
+		auto settled = std::vector<int>();
+		for (auto current = buckets.begin(); current != buckets.end() && current->first == bucket; current = buckets.begin())
+		{
+			// remove duplicates and entries that moved to an earlier bucket after insertion.
+			auto frontier = std::move(current->second);
+			buckets.erase(current);
+			std::sort(frontier.begin(), frontier.end());
+			frontier.erase(std::unique(frontier.begin(), frontier.end()), frontier.end());
+			frontier.erase(std::remove_if(frontier.begin(), frontier.end(), [&](int vertex) {
+				return bucket_of(vertex) != bucket;
+				}), frontier.end());
+
+			relax(frontier, true);
+			settled.insert(settled.end(), frontier.begin(), frontier.end());
+		}
+
+		std::sort(settled.begin(), settled.end());
+		settled.erase(std::unique(settled.begin(), settled.end()), settled.end());
+		relax(settled, false);
+	}
+
+	auto result = std::vector<Weight>(num_vertices);
+	for (int vertex = 0; vertex < num_vertices; ++vertex)
+		result[vertex] = path_weight[vertex].load(std::memory_order_relaxed);
+	return result;
+}
+
+// Average edge weight of the graph, the default bucket width of delta_stepping().
+// Always positive, so that a graph of zero weight edges still gets a usable width.
+template<typename Weight>
+Weight average_edge_weight(const std::vector<std::vector<WeightedEdge<Weight>>>& edges)
+{
+	auto total = 0.0L;
+	auto count = std::size_t(0);
+	for (const auto& outgoing : edges)
+		for (const auto& [to, weight] : outgoing)
+		{
+			total += weight;
+			++count;
+		}
+
+	auto average = static_cast<Weight>(count > 0 ? total / count : 1);
+	return average > Weight(0) ? average : Weight(1);
+}
+
+// Same as dijkstra(), but stops as soon as target is popped from the queue
+// and returns the shortest path weight to target (infinite if unreachable).
+// Only vertices closer than target are explored.
+template<typename Weight>
+Weight dijkstra_to(int num_vertices, int source, int target, const std::vector<std::vector<WeightedEdge<Weight>>>& edges)
+{
+	std::vector<Weight> path_weight(num_vertices, infinite<Weight>());
+	std::vector<int> visited(num_vertices, false);
+	MinQueue<Weight> queue;
+	queue.push({ 0, source });
+	path_weight[source] = 0;
+
+	while (!queue.empty())
+	{
+		auto [cost, next] = queue.top();
+		queue.pop();
+
+		if (next == target)
+			return cost;
+
+		if (!visited[next]) {
+			visited[next] = true;
+
+			for (const auto& [to, weight] : edges[next])
+			{
+				PROFILE_COUNT("shortest_path::relaxations", 1);
+				auto new_weight = add_weight(path_weight[next], weight);
+				if (path_weight[to] > new_weight)
+				{
+					path_weight[to] = new_weight;
+					PROFILE_COUNT("shortest_path::heap_pushes", 1);
+					queue.push({ new_weight, to });
+				}
+			}
+		}
+	}
+
+	return infinite<Weight>();
+}
+
+// Compressed sparse row form of an adjacency list.
+// Outgoing edges of every vertex are stored contiguously in a single array,
+// so that walking the edges of a vertex doesn't chase a separate allocation per vertex.
+class CsrGraph
+{
+public:
+	struct EdgeRange
+	{
+		const Edge* first;
+		const Edge* last;
+
+		const Edge* begin() const { return first; }
+		const Edge* end() const { return last; }
+	};
+
+	CsrGraph() = default;
+
+	CsrGraph(const std::vector<std::vector<Edge>>& edges)
+		: offset(edges.size() + 1, 0)
+	{
+		PROFILE_SCOPE("shortest_path::csr_build");
+		for (size_t from = 0; from < edges.size(); ++from)
+			offset[from + 1] = offset[from] + static_cast<int>(edges[from].size());
+
+		edge.reserve(offset.back());
+		for (const auto& outgoing : edges)
+			edge.insert(edge.end(), outgoing.begin(), outgoing.end());
+	}
+
+	// Graph with every edge reversed (i.e. ith element lists edges incoming to vertex i).
+	CsrGraph reverse() const
+	{
+		auto result = CsrGraph();
+		result.offset.assign(offset.size(), 0);
+		result.edge.resize(edge.size());
+
+		for (const auto& [to, weight] : edge)
+			++result.offset[to + 1];
+		for (size_t vertex = 1; vertex < result.offset.size(); ++vertex)
+			result.offset[vertex] += result.offset[vertex - 1];
+
+		auto position = std::vector<int>(result.offset.begin(), result.offset.end() - 1);
+		for (int from = 0; from < size(); ++from)
+			for (const auto& [to, weight] : (*this)[from])
+				result.edge[position[to]++] = { from, weight };
+
+		return result;
+	}
+
+	int size() const
+	{
+		return static_cast<int>(offset.size()) - 1;
+	}
+
+	EdgeRange operator[](int vertex) const
+	{
+		return { edge.data() + offset[vertex], edge.data() + offset[vertex + 1] };
+	}
+
+	// Binary layout : offset size, edge size, offset array, edge array.
+	void write(std::ostream& output) const
+	{
+		int sizes[2] = { static_cast<int>(offset.size()), static_cast<int>(edge.size()) };
+		output.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+		output.write(reinterpret_cast<const char*>(offset.data()), sizeof(int) * offset.size());
+		output.write(reinterpret_cast<const char*>(edge.data()), sizeof(Edge) * edge.size());
+	}
+
+	// Returns false if the stream doesn't contain a complete and consistent graph.
+	// Sizes are checked against the rest of the stream before allocating, since a corrupt file could ask for any amount of memory.
+	bool read(std::istream& input)
+	{
+		int sizes[2] = { 0, 0 };
+		if (!input.read(reinterpret_cast<char*>(sizes), sizeof(sizes)))
+			return false;
+
+		auto position = input.tellg();
+		input.seekg(0, std::ios::end);
+		auto remaining = static_cast<std::int64_t>(input.tellg() - position);
+		input.seekg(position);
+		if (sizes[0] < 1 || sizes[1] < 0
+			|| remaining < static_cast<std::int64_t>(sizeof(int)) * sizes[0] + static_cast<std::int64_t>(sizeof(Edge)) * sizes[1])
+			return false;
+
+		offset.resize(sizes[0]);
+		edge.resize(sizes[1]);
+		if (!input.read(reinterpret_cast<char*>(offset.data()), sizeof(int) * offset.size())
+			|| !input.read(reinterpret_cast<char*>(edge.data()), sizeof(Edge) * edge.size()))
+			return false;
+
+		if (offset.front() != 0 || offset.back() != sizes[1] || !std::is_sorted(offset.begin(), offset.end()))
+			return false;
+		return std::all_of(edge.begin(), edge.end(), [&](const Edge& e) {
+			return 0 <= e.to && e.to < size();
+			});
+	}
+
+private:
+	std::vector<int> offset;
+	std::vector<Edge> edge;
+};
+
+// Reads "[vertex1] [vertex2] [edge weight]" lines until the end of file.
+// Contain all directed edge information in form edges[from] = {from->dest1, from->dest2, ...}.
+// In other words, ith element of edges correspond to list of edges outgoing from ith vertex.
+// The number of vertices is one more than the largest vertex index in the file.
+// Returns std::nullopt if the file can't be opened, or a line can't be read with Weight weights
+// (e.g. "0 1 2.5" as int, which would otherwise end the graph early) or has a negative vertex.
+template<typename Weight = int>
+std::optional<std::vector<std::vector<WeightedEdge<Weight>>>> load_graph(const std::string& file_name)
+{
+	PROFILE_SCOPE("shortest_path::load_graph");
+	auto edges = std::vector<std::vector<WeightedEdge<Weight>>>();
+	auto input_file = std::ifstream(file_name);
+	if (!input_file)
+		return std::nullopt;
+
+	int from, to;
+	Weight weight;
+	while (input_file >> from >> to >> weight)
+	{
+		if (from < 0 || to < 0)
+			return std::nullopt;
+		auto needed = static_cast<size_t>(std::max(from, to)) + 1;
+		if (edges.size() < needed)
+			edges.resize(needed);
 		edges[from].push_back({ to, weight });
 	}
+	if (!input_file.eof())
+		return std::nullopt;
+	return edges;
+}
+
+// Same graph with edge weights converted to another type.
+template<typename To, typename From>
+std::vector<std::vector<WeightedEdge<To>>> convert_weights(const std::vector<std::vector<WeightedEdge<From>>>& edges)
+{
+	auto result = std::vector<std::vector<WeightedEdge<To>>>(edges.size());
+	for (size_t from = 0; from < edges.size(); ++from)
+	{
+		result[from].reserve(edges[from].size());
+		for (const auto& [to, weight] : edges[from])
+			result[from].push_back({ to, static_cast<To>(weight) });
+	}
+	return result;
+}
+
+// True if every shortest path weight of a graph with num_vertices vertices and largest edge weight can be stored in Weight.
+// A shortest path has at most (num_vertices - 1) edges, so (num_vertices - 1) * largest edge weight
+// must stay below infinite<Weight>(), which is reserved for unreachable vertices.
+template<typename Weight>
+bool fits_path_weight(long double largest, size_t num_vertices)
+{
+	auto longest = largest * std::max<size_t>(num_vertices, 1) - largest;
+	return longest < static_cast<long double>(infinite<Weight>());
+}
+
+// True if every edge weight and every shortest path weight of the graph can be stored in Weight.
+template<typename Weight, typename From>
+bool fits_path_weights(const std::vector<std::vector<WeightedEdge<From>>>& edges)
+{
+	auto largest = From(0);
+	for (const auto& outgoing : edges)
+		for (const auto& [to, weight] : outgoing)
+		{
+			if constexpr (std::is_integral_v<Weight>)
+				if (weight != static_cast<From>(static_cast<Weight>(weight)))
+					return false;
+			largest = std::max(largest, weight);
+		}
+
+	return fits_path_weight<Weight>(largest, edges.size());
+}
 
-	return dijkstra(num_vertices, 12656, edges)[4569];
+template<typename Weight>
+struct LongestShortestPath
+{
+	int source;
+	int dest;
+	Weight weight;
+	// Number of sources examined. Less than the number of vertices if deadline was passed.
+	int num_sources;
+};
 
+// Longest path among all-pair shortest paths, ignoring disconnected pairs.
+//
+// Multithreading configuration.
+// num_groups : number of vertex group to process at one time.
+// num_threads : number of threads created for each group.
+// For example, (num_group = 2, num_vertices = 1000, num_threads = 10) means
+// vertex 0 ~ 999 is divided into two groups 0~499 and 500~999. Each group's vertices
+// is distibuted to four threads evenly to find the local longest shortest path solution whith that vertex as source node
+// (e.g. lsp of vertex 0~49 from thread 1, lsp of vertex 50~99 from thread 2, ...)
+//
+// If use_batch is true, each thread processes its sources BATCH_WIDTH at a time using dijkstra_batch()
+// instead of calling dijkstra() once per source.
+// Once deadline is passed, remaining sources are skipped and the best path found so far is returned.
+template<typename Weight>
+LongestShortestPath<Weight> longest_shortest_path(const std::vector<std::vector<WeightedEdge<Weight>>>& edges, int num_groups, int num_threads, bool use_batch, Deadline deadline = Deadline::max())
+{
+	PROFILE_SCOPE("shortest_path::sweep");
+	auto num_vertices = static_cast<int>(edges.size());
+	num_groups = std::max(1, std::min(num_groups, num_vertices));
 
 	// Temporary storage to save the lastest longest shortest path solution.
 	// After each thread returns their local solutions, they are compared with this
 	// global solution and update it if the local solution was better (i.e. found longer shortest path)
-	auto max_src = 0;
-	auto max_dest = 0;
-	auto max_weight = 0;
-	
-/*
-
-16000.graph result : 12657 -> 4569 : 107
-32000.graph result : 28850 -> 12334 : 131
-1000000.graph intermediate result :
-405591 125606 181
-460789 101238 176
-516243 119126 177
-522562 170395 182
-533221 170395 186
-648038 166859 188
-668343 173976 189
-773670 173976 190
-842487 252404 197
-*/
-
+	auto best = LongestShortestPath<Weight>{ 0, 0, Weight(0), 0 };
 
 	// First two for-loop calculates distribution of vertices on each thread.
 	// The threads will perform dijkstra's algorithm with source as vertex t_start ~ t_end.
 	auto source_per_group = num_vertices / num_groups;
-	for (auto group = 0; group < num_groups; ++group)
+	for (auto group = 0; group < num_groups && std::chrono::steady_clock::now() < deadline; ++group)
 	{
-		std::cout << "group : " << group << std::endl;
 		auto start = source_per_group * group;
 		auto end = group == num_groups - 1 ? num_vertices : start + source_per_group;
 
 		auto source_per_thread = (end - start) / num_threads;
-		auto results = std::vector<std::future<std::tuple<int, int, int>>>();
+		auto results = std::vector<std::future<LongestShortestPath<Weight>>>();
 		for (auto t = 0; t < num_threads; ++t)
 		{
 			auto t_start = start + source_per_thread * t;
@@ -126,25 +712,42 @@ int main()
 
 			// Start a new thread and save the std::future instance to get result later.
 			results.emplace_back(std::async(std::launch::async, [&, t_start, t_end] {
-				auto max_src = 0;
-				auto max_dest = 0;
-				auto max_weight = 0;
-				for (auto source = t_start; source < t_end; ++source) {
-					auto paths = dijkstra(num_vertices, source, edges);
-
-					// Update if any shortest path with source vertex "source" is longer than local optima (but not disconnected, i.e. INFINITE)
-					for (int dest = 0; dest < num_vertices; ++dest) {
-						if (paths[dest] > max_weight && paths[dest] != INFINITE)
-						{
-							max_src = source;
-							max_dest = dest;
-							max_weight = paths[dest];
-						}
+				PROFILE_SCOPE("shortest_path::sweep_thread");
+				auto local = LongestShortestPath<Weight>{ 0, 0, Weight(0), 0 };
+				// Update if any shortest path with source vertex "source" is longer than local optima (but not disconnected, i.e. infinite)
+				auto update = [&](int source, int dest, Weight weight) {
+					if (weight > local.weight && weight != infinite<Weight>())
+						local = { source, dest, weight, local.num_sources };
+				};
+
+				if (use_batch)
+				{
+					for (auto source = t_start; source < t_end && std::chrono::steady_clock::now() < deadline; source += BATCH_WIDTH) {
+						// the last batch of a thread may have less than BATCH_WIDTH sources.
+						// unused lanes repeat the last source and are ignored afterwards.
+						auto num_lanes = std::min(BATCH_WIDTH, t_end - source);
+						auto sources = std::array<int, BATCH_WIDTH>();
+						for (int lane = 0; lane < BATCH_WIDTH; ++lane)
+							sources[lane] = source + std::min(lane, num_lanes - 1);
+
+						auto paths = dijkstra_batch(num_vertices, sources, edges);
+						for (int lane = 0; lane < num_lanes; ++lane)
+							for (int dest = 0; dest < num_vertices; ++dest)
+								update(sources[lane], dest, paths[dest][lane]);
+						local.num_sources += num_lanes;
+					}
+				}
+				else
+				{
+					for (auto source = t_start; source < t_end && std::chrono::steady_clock::now() < deadline; ++source) {
+						auto paths = dijkstra(num_vertices, source, edges);
+						for (int dest = 0; dest < num_vertices; ++dest)
+							update(source, dest, paths[dest]);
+						++local.num_sources;
 					}
 				}
 
-				std::cout << "thread end\n";
-				return std::tuple{ max_src, max_dest, max_weight };
+				return local;
 				}));
 		}
 
@@ -152,31 +755,30 @@ int main()
 		// update the global solution.
 		for (auto& result : results)
 		{
-			auto [src, dest, weight] = result.get();
-			if (max_weight < weight && weight != INFINITE)
-			{
-				max_src = src;
-				max_dest = dest;
-				max_weight = weight;
-			}
+			auto local = result.get();
+			best.num_sources += local.num_sources;
+			if (best.weight < local.weight)
+				best = { local.source, local.dest, local.weight, best.num_sources };
 		}
-
-		std::cout << "                                 " << max_src << " " << max_dest << " " << max_weight << std::endl;
 	}
 
-	system("pause");
+	return best;
+}
 
-	//for (auto source = 0; source < num_vertices; ++source)
-	//{
-	//	std::cout << "pass : " << source << std::endl;
-	//	auto start = std::chrono::steady_clock::now();
+/*
 
-	//	auto path = dijkstra(num_vertices, 12657, edges);
-	//	auto end = std::chrono::steady_clock::now();
-	//	//std::cout << "duration : " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()/1000.0 << std::endl;
+16000.graph result : 12657 -> 4569 : 107
+32000.graph result : 28850 -> 12334 : 131
+1000000.graph intermediate result :
+405591 125606 181
+460789 101238 176
+516243 119126 177
+522562 170395 182
+533221 170395 186
+648038 166859 188
+668343 173976 189
+773670 173976 190
+842487 252404 197
+*/
 
-	//	for (auto& p : path)
-	//		output_file << p << " ";
-	//	output_file << std::endl;
-	//}
-}
\ No newline at end of file
+}
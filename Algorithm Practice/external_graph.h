@@ -0,0 +1,332 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include "dijkstra.h"
+#include "mapped_file.h"
+
+namespace shortest_path
+{
+// Graph stored on disk in compressed sparse row form, for graphs whose edges don't fit in memory.
+// Only the per-vertex offsets are kept in memory. Edges are read by memory mapping one vertex range (partition) at a time.
+//
+// File layout :
+//   Header
+//   offset array (num_vertices + 1 int64, index into the edge array)
+//   edge array (Edge), starting at a page aligned position
+class ExternalCsrGraph
+{
+public:
+	struct Header
+	{
+		std::int32_t magic;
+		std::int32_t version;
+		std::int64_t num_vertices;
+		std::int64_t num_edges;
+		std::int64_t partition_size;
+		std::int64_t edge_start;
+		// 64 bit hash of the text input the file was converted from.
+		std::uint64_t graph_hash;
+	};
+
+	// Edges of vertices in [first_vertex, last_vertex) mapped into memory.
+	class Partition
+	{
+	public:
+		Partition(const ExternalCsrGraph& graph, int index)
+			: graph(graph),
+			first_vertex(static_cast<int>(index * graph.header.partition_size)),
+			last_vertex(static_cast<int>(std::min((index + 1) * graph.header.partition_size, graph.header.num_vertices))),
+			region(graph.file_name,
+				graph.header.edge_start + graph.offset[first_vertex] * static_cast<std::int64_t>(sizeof(Edge)),
+				static_cast<size_t>(graph.offset[last_vertex] - graph.offset[first_vertex]) * sizeof(Edge))
+		{
+			PROFILE_COUNT("shortest_path::partition_loads", 1);
+		}
+
+		bool is_valid() const
+		{
+			return region.is_valid();
+		}
+
+		bool contains(int vertex) const
+		{
+			return first_vertex <= vertex && vertex < last_vertex;
+		}
+
+		CsrGraph::EdgeRange operator[](int vertex) const
+		{
+			auto first = reinterpret_cast<const Edge*>(region.data());
+			return {
+				first + (graph.offset[vertex] - graph.offset[first_vertex]),
+				first + (graph.offset[vertex + 1] - graph.offset[first_vertex])
+			};
+		}
+
+	private:
+		const ExternalCsrGraph& graph;
+		int first_vertex;
+		int last_vertex;
+		MappedRegion region;
+	};
+
+	// Returns false if the file doesn't exist, isn't a consistent graph with expected number of vertices,
+	// or was converted from a different input (other graph_hash).
+	bool open(const std::string& file_name, int expected_vertices, std::uint64_t graph_hash)
+	{
+		this->file_name = file_name;
+
+		auto input = std::ifstream(file_name, std::ios::binary);
+		if (!input.read(reinterpret_cast<char*>(&header), sizeof(header))
+			|| header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.num_vertices != expected_vertices
+			|| header.graph_hash != graph_hash || header.partition_size <= 0 || header.num_edges < 0)
+			return false;
+
+		offset.resize(header.num_vertices + 1);
+		if (!input.read(reinterpret_cast<char*>(offset.data()), sizeof(std::int64_t) * offset.size()))
+			return false;
+
+		// mapping past the end of a truncated file would only fail when the edges are accessed.
+		input.seekg(0, std::ios::end);
+		if (static_cast<std::int64_t>(input.tellg()) < header.edge_start + header.num_edges * static_cast<std::int64_t>(sizeof(Edge)))
+			return false;
+		return offset.front() == 0 && offset.back() == header.num_edges && std::is_sorted(offset.begin(), offset.end());
+	}
+
+	// Convert text input ("[from] [to] [weight]" per line) into the binary layout above.
+	// The conversion never holds more than one partition of edges in memory:
+	// 1. count outgoing edges of each vertex to build the offset array.
+	// 2. append each edge to a temporary file of the partition containing its source vertex.
+	// 3. load each partition, sort its edges by source vertex with counting sort, and append them to the output.
+	// Returns false if a file can't be opened, read or written, an edge has a vertex outside [0, num_vertices),
+	// or a shortest path weight might not fit in int (see fits_path_weight()), since the graph is int weighted.
+	// binary_file is then left incomplete, and open() rejects it.
+	// graph_hash is stored in the header (see open()).
+	static bool convert(const std::string& text_file, const std::string& binary_file, int num_vertices, int partition_size, std::uint64_t graph_hash)
+	{
+		PROFILE_SCOPE("shortest_path::external_convert");
+		if (num_vertices <= 0 || partition_size <= 0)
+			return false;
+
+		auto header = Header{ FILE_MAGIC, FILE_VERSION, num_vertices, 0, partition_size, 0, graph_hash };
+		auto num_partitions = static_cast<int>((header.num_vertices + partition_size - 1) / partition_size);
+		auto is_vertex = [&](int vertex) {
+			return 0 <= vertex && vertex < num_vertices;
+		};
+
+		auto offset = std::vector<std::int64_t>(num_vertices + 1, 0);
+		{
+			auto input = std::ifstream(text_file);
+			if (!input)
+				return false;
+			int from, to, weight;
+			auto largest = 0;
+			while (input >> from >> to >> weight)
+			{
+				if (!is_vertex(from) || !is_vertex(to))
+					return false;
+				++offset[from + 1];
+				largest = std::max(largest, weight);
+			}
+			// a weight that doesn't parse as int stops the loop before the end of file.
+			if (!input.eof() || !fits_path_weight<int>(largest, num_vertices))
+				return false;
+		}
+		for (int vertex = 0; vertex < num_vertices; ++vertex)
+			offset[vertex + 1] += offset[vertex];
+		header.num_edges = offset.back();
+
+		auto page = MappedRegion::granularity();
+		auto offset_end = static_cast<std::int64_t>(sizeof(Header) + sizeof(std::int64_t) * offset.size());
+		header.edge_start = (offset_end + page - 1) / page * page;
+
+		auto part_name = [&](int partition) {
+			return binary_file + ".part" + std::to_string(partition);
+		};
+
+		auto remove_parts = [&] {
+			for (int partition = 0; partition < num_partitions; ++partition)
+				std::remove(part_name(partition).c_str());
+		};
+
+		{
+			auto parts = std::vector<std::ofstream>();
+			for (int partition = 0; partition < num_partitions; ++partition)
+				parts.emplace_back(part_name(partition), std::ios::binary);
+
+			// vertices are checked again in case the text file changed since the first pass.
+			auto input = std::ifstream(text_file);
+			auto valid = static_cast<bool>(input);
+			int record[3];
+			while (valid && input >> record[0] >> record[1] >> record[2])
+			{
+				valid = is_vertex(record[0]) && is_vertex(record[1]);
+				if (valid)
+					parts[record[0] / partition_size].write(reinterpret_cast<const char*>(record), sizeof(record));
+			}
+			valid = valid && input.eof();
+
+			valid = valid && std::all_of(parts.begin(), parts.end(), [](const auto& part) {
+				return static_cast<bool>(part);
+				});
+			if (!valid)
+			{
+				parts.clear();
+				remove_parts();
+				return false;
+			}
+		}
+
+		auto output = std::ofstream(binary_file, std::ios::binary);
+		if (!output)
+		{
+			remove_parts();
+			return false;
+		}
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		output.write(reinterpret_cast<const char*>(offset.data()), sizeof(std::int64_t) * offset.size());
+		auto padding = std::vector<char>(static_cast<size_t>(header.edge_start - offset_end), 0);
+		output.write(padding.data(), padding.size());
+
+		for (int partition = 0; partition < num_partitions; ++partition)
+		{
+			auto first_vertex = partition * partition_size;
+			auto last_vertex = static_cast<int>(std::min<std::int64_t>(first_vertex + static_cast<std::int64_t>(partition_size), num_vertices));
+			auto base = offset[first_vertex];
+
+			auto edges = std::vector<Edge>(static_cast<size_t>(offset[last_vertex] - base));
+			auto position = std::vector<std::int64_t>(offset.begin() + first_vertex, offset.begin() + last_vertex);
+			auto complete = true;
+			{
+				auto input = std::ifstream(part_name(partition), std::ios::binary);
+				int record[3];
+				while (input.read(reinterpret_cast<char*>(record), sizeof(record)))
+				{
+					// a vertex with more edges than counted in the first pass means the text file changed in between.
+					auto& next = position[record[0] - first_vertex];
+					if (next == offset[record[0] + 1])
+					{
+						complete = false;
+						break;
+					}
+					edges[static_cast<size_t>(next++ - base)] = { record[1], record[2] };
+				}
+			}
+			std::remove(part_name(partition).c_str());
+			if (!complete)
+			{
+				remove_parts();
+				return false;
+			}
+
+			output.write(reinterpret_cast<const char*>(edges.data()), sizeof(Edge) * edges.size());
+		}
+		return static_cast<bool>(output);
+	}
+
+	int size() const
+	{
+		return static_cast<int>(header.num_vertices);
+	}
+
+	int num_partitions() const
+	{
+		return static_cast<int>((header.num_vertices + header.partition_size - 1) / header.partition_size);
+	}
+
+	int partition_of(int vertex) const
+	{
+		return static_cast<int>(vertex / header.partition_size);
+	}
+
+private:
+	static constexpr std::int32_t FILE_MAGIC = 0x525343; // "CSR"
+	// version 1 files (without graph_hash) are converted again.
+	static constexpr std::int32_t FILE_VERSION = 2;
+
+	std::string file_name;
+	Header header = {};
+	std::vector<std::int64_t> offset;
+};
+
+// SSSP over a graph on disk.
+// Dijkstra over the whole graph would touch partitions in random order, so this streams partitions instead:
+// vertices whose path weight was lowered are queued on the partition they belong to,
+// and the partition with the smallest queued path weight is mapped and processed with dijkstra restricted to its own vertices.
+// Edges leading to other partitions only queue their destination.
+// This repeats until no vertex is queued, and the result is the same as dijkstra().
+// A vertex may be processed more than once if a shorter path is found after its partition was visited.
+// Returns std::nullopt if a partition can't be mapped or contains an edge to a vertex outside the graph,
+// since the path weights found so far would not be final.
+inline std::optional<std::vector<int>> external_dijkstra(const ExternalCsrGraph& graph, int source)
+{
+	PROFILE_SCOPE("shortest_path::external_dijkstra");
+	auto num_vertices = graph.size();
+	std::vector<int> path_weight(num_vertices, INFINITE);
+	path_weight[source] = 0;
+
+	auto pending = std::vector<std::vector<int>>(graph.num_partitions());
+	auto pending_min = std::vector<int>(graph.num_partitions(), INFINITE);
+	pending[graph.partition_of(source)].push_back(source);
+	pending_min[graph.partition_of(source)] = 0;
+
+	while (true)
+	{
+		auto index = static_cast<int>(std::min_element(pending_min.begin(), pending_min.end()) - pending_min.begin());
+		if (pending_min[index] == INFINITE)
+			break;
+
+		auto partition = ExternalCsrGraph::Partition(graph, index);
+		if (!partition.is_valid())
+			return std::nullopt;
+
+		std::priority_queue<
+			std::pair<int, int>,
+			std::vector<std::pair<int, int>>,
+			std::greater<std::pair<int, int>>
+		> queue;
+		for (auto vertex : pending[index])
+			queue.push({ path_weight[vertex], vertex });
+		pending[index].clear();
+		pending_min[index] = INFINITE;
+
+		while (!queue.empty())
+		{
+			auto [cost, next] = queue.top();
+			queue.pop();
+			if (cost > path_weight[next])
+				continue;
+
+			for (const auto& [to, weight] : partition[next])
+			{
+				if (to < 0 || to >= num_vertices)
+					return std::nullopt;
+
+				auto new_weight = add_weight(cost, weight);
+				if (path_weight[to] > new_weight)
+				{
+					path_weight[to] = new_weight;
+					if (partition.contains(to))
+					{
+						queue.push({ new_weight, to });
+					}
+					else
+					{
+						auto other = graph.partition_of(to);
+						pending[other].push_back(to);
+						pending_min[other] = std::min(pending_min[other], new_weight);
+					}
+				}
+			}
+		}
+	}
+
+	return path_weight;
+}
+
+}
\ No newline at end of file
@@ -5,21 +5,43 @@
 #include <sstream>
 #include <vector>
 #include <algorithm>
-
+#include <cmath>
+#include <tuple>
+#include <limits>
+#include <cstdint>
+#include <optional>
+#include "profiling.h"
+
+namespace knapsack
+{
 struct Item
 {
 	int weight;
 	int value;
 };
 
-void trim(std::string prefix, std::string postfix, std::string& data)
+// Returns false if data doesn't start with prefix and end with postfix.
+inline bool trim(std::string prefix, std::string postfix, std::string& data)
 {
+	if (data.length() < prefix.length() + postfix.length()
+		|| data.compare(0, prefix.length(), prefix) != 0
+		|| data.compare(data.length() - postfix.length(), postfix.length(), postfix) != 0)
+		return false;
 	data = data.substr(prefix.length(), data.length() - prefix.length() - postfix.length());
+	return true;
 }
 
-std::vector<Item> parse_file(std::string file_name, int amplifier)
+// since raw weight and values are small real numbers,
+// multiplying big number and rounding it gives good integer approximation.
+// amplifier of 10^n can be thought as n-digit precision.
+// Returns std::nullopt if the file can't be opened, isn't in "weight [...]\nvalue [...]" form,
+// or the two lists don't have the same number of items.
+inline std::optional<std::vector<Item>> parse_file(std::string file_name, int amplifier)
 {
+	PROFILE_SCOPE("knapsack::parse_file");
 	auto input = std::ifstream(file_name);
+	if (!input)
+		return std::nullopt;
 
 	// first line contains weight list
 	// second line contains value list
@@ -27,10 +49,13 @@ std::vector<Item> parse_file(std::string file_name, int amplifier)
 	auto value_data = std::string("");
 	std::getline(input, weight_data);
 	std::getline(input, value_data);
+	for (auto data : { &weight_data, &value_data })
+		if (!data->empty() && data->back() == '\r')
+			data->pop_back();
 
 	// trim prefix and postfix to get internal values delimited by ", "
-	trim("weight [", "]", weight_data);
-	trim("value [", "]", value_data);
+	if (!trim("weight [", "]", weight_data) || !trim("value [", "]", value_data))
+		return std::nullopt;
 
 	// convert input string to stream
 	auto weight_stream = std::stringstream(weight_data);
@@ -41,31 +66,41 @@ std::vector<Item> parse_file(std::string file_name, int amplifier)
 
 	auto result = std::vector<Item>();
 
-	while (weight_stream)
+	while (true)
 	{
 		double real_value;
 		double real_weight;
-		weight_stream >> real_weight >> comma;
-		value_stream >> real_value >> comma;
+		if (!(weight_stream >> real_weight) || !(value_stream >> real_value))
+			return std::nullopt;
 
 		// convert real number data into approximated integer value.
-		// more explanation can be found at main function's comment
-		// about variable named "amplifier"
 		result.push_back(
 			{
 				(int)std::round(real_weight * amplifier),
 				(int)std::round(real_value * amplifier)
 			}
 		);
+
+		// both lists either end here or continue after a comma.
+		auto weight_continues = static_cast<bool>(weight_stream >> comma);
+		if (weight_continues && comma != ",")
+			return std::nullopt;
+		auto value_continues = static_cast<bool>(value_stream >> comma);
+		if (value_continues && comma != ",")
+			return std::nullopt;
+		if (weight_continues != value_continues)
+			return std::nullopt;
+		if (!weight_continues)
+			break;
 	}
 
 	return result;
 }
 
 // solve 0-1 knapsack with raw recursion
-int knapsack_dp_raw(const std::vector<Item>& items, int weight, int pos = 0)
+inline int knapsack_dp_raw(const std::vector<Item>& items, int weight, int pos = 0)
 {
-	if (pos >= items.size())
+	if (pos >= static_cast<int>(items.size()))
 		return 0;
 
 	if (weight - items[pos].weight < 0)
@@ -81,16 +116,45 @@ int knapsack_dp_raw(const std::vector<Item>& items, int weight, int pos = 0)
 	}
 }
 
+// Memoization table entry that is not computed yet.
+template<typename Value>
+constexpr Value UNSOLVED = std::numeric_limits<Value>::lowest();
+
+// lookup[pos][weight] : best value of items[pos...] within weight, or UNSOLVED.
+// Value can be any signed integer type that holds the sum of all item values (see fits_values()).
+// Narrower types make the table smaller, which is most of the memory traffic of the dp.
+template<typename Value>
+using LookupTable = std::vector<std::vector<Value>>;
+
+template<typename Value = int>
+LookupTable<Value> make_lookup(size_t num_items, int max_weight)
+{
+	PROFILE_SCOPE("knapsack::make_lookup");
+	return LookupTable<Value>(num_items, std::vector<Value>(max_weight + 1, UNSOLVED<Value>));
+}
+
+// True if the total value of all items (the largest value the dp can produce) fits in Value.
+template<typename Value>
+bool fits_values(const std::vector<Item>& items)
+{
+	auto total = std::int64_t(0);
+	for (const auto& item : items)
+		total += item.value;
+	return total < std::numeric_limits<Value>::max();
+}
+
 // solve 0-1 knapsack with memoization
-int knapsack_dp(const std::vector<Item>& items, std::vector<std::vector<int>>& lookup, int weight, int pos = 0)
+template<typename Value>
+Value knapsack_dp(const std::vector<Item>& items, LookupTable<Value>& lookup, int weight, int pos = 0)
 {
-	if (pos >= items.size())
+	if (pos >= static_cast<int>(items.size()))
 	{
 		return 0;
 	}
 
-	if (lookup[pos][weight] == -1)
+	if (lookup[pos][weight] == UNSOLVED<Value>)
 	{
+		PROFILE_COUNT("knapsack::dp_cells", 1);
 		if (weight - items[pos].weight < 0)
 		{
 			lookup[pos][weight] = knapsack_dp(items, lookup, weight, pos + 1);
@@ -99,7 +163,7 @@ int knapsack_dp(const std::vector<Item>& items, std::vector<std::vector<int>>& l
 		{
 			lookup[pos][weight] = std::max(
 				knapsack_dp(items, lookup, weight, pos + 1),
-				knapsack_dp(items, lookup, weight - items[pos].weight, pos + 1) + items[pos].value
+				static_cast<Value>(knapsack_dp(items, lookup, weight - items[pos].weight, pos + 1) + items[pos].value)
 			);
 		}
 
@@ -108,15 +172,17 @@ int knapsack_dp(const std::vector<Item>& items, std::vector<std::vector<int>>& l
 	return lookup[pos][weight];
 }
 
-int knapsack_dp_track_activation(const std::vector<Item>& items, std::vector<std::vector<int>>& lookup, std::vector<std::vector<std::tuple<int, int, bool>>>& activation, int weight, int pos = 0)
+template<typename Value>
+Value knapsack_dp_track_activation(const std::vector<Item>& items, LookupTable<Value>& lookup, std::vector<std::vector<std::tuple<int, int, bool>>>& activation, int weight, int pos = 0)
 {
-	if (pos >= items.size())
+	if (pos >= static_cast<int>(items.size()))
 	{
 		return 0;
 	}
 
-	if (lookup[pos][weight] == -1)
+	if (lookup[pos][weight] == UNSOLVED<Value>)
 	{
+		PROFILE_COUNT("knapsack::dp_cells", 1);
 		if (weight - items[pos].weight < 0)
 		{
 			activation[pos][weight] = { weight, pos + 1, false };
@@ -127,7 +193,7 @@ int knapsack_dp_track_activation(const std::vector<Item>& items, std::vector<std
 			auto new_weight = weight - items[pos].weight;
 
 			auto ignore = knapsack_dp_track_activation(items, lookup, activation, weight, pos + 1);
-			auto include = knapsack_dp_track_activation(items, lookup, activation, new_weight, pos + 1) + items[pos].value;
+			auto include = static_cast<Value>(knapsack_dp_track_activation(items, lookup, activation, new_weight, pos + 1) + items[pos].value);
 
 			if (ignore > include)
 			{
@@ -148,25 +214,39 @@ int knapsack_dp_track_activation(const std::vector<Item>& items, std::vector<std
 
 
 // print whether each item is selected or not in binary form
-void trace_activation(const std::vector<std::vector<std::tuple<int, int, bool>>>& activation, int weight, int pos = 0)
+inline void trace_activation(const std::vector<std::vector<std::tuple<int, int, bool>>>& activation, int weight, int pos = 0)
 {
-	if (pos >= activation.size())
+	if (pos >= static_cast<int>(activation.size()))
 		return;
 
 	auto [next_weight, next_pos, included] = activation[pos][weight];
-	std::cout << included ? "1" : "0";
+	std::cout << (included ? "1" : "0");
 	trace_activation(activation, next_weight, next_pos);
 }
 
+// same as trace_activation(), returned as a string instead of printed.
+inline std::string selection(const std::vector<std::vector<std::tuple<int, int, bool>>>& activation, int weight)
+{
+	auto result = std::string();
+	for (size_t pos = 0; pos < activation.size();)
+	{
+		auto [next_weight, next_pos, included] = activation[pos][weight];
+		result += included ? '1' : '0';
+		weight = next_weight;
+		pos = next_pos;
+	}
+	return result;
+}
+
 // checks if selection output does produce expected value and weight.
 // "items" should be the data used on computing selection,
 // so don't panic if error message shows up when
 // validating 30.kp solution with 300.kp data.
-void verify(const std::vector<Item>& items, std::string selection, int output_value, int max_weight)
+inline void verify(const std::vector<Item>& items, std::string selection, int output_value, int max_weight)
 {
 	int value_sum = 0;
 	int weight_sum = 0;
-	for (int i = 0; i < selection.length(); ++i)
+	for (int i = 0; i < static_cast<int>(selection.length()); ++i)
 	{
 		if (selection[i] == '1')
 		{
@@ -202,61 +282,4 @@ void verify(const std::vector<Item>& items, std::string selection, int output_va
 	000000000000001010000000001000000010000000000000000001010000010010000100000001010010000000000001010100000000000000000000000000100000000000000000001000000010000100000010000101000001000000000000100000100000110000000010000000000000000001000000010000010000000000000010000010000000000000010000000100010000
 */
 
-#include <chrono>
-using namespace std::chrono;
-
-//148700
-//22851800
-
-int main()
-{
-
-	// since raw weight and values are small real numbers,
-	// multiplying big number and rounding it gives good integer approximation.
-	// amplifier of 10^n can be thought as n-digit precision.
-	constexpr auto amplifier = 100000;
-	auto max_weight = 3 * amplifier;
-
-	// read and approximate data to integer values
-	auto items = parse_file("30.kp", amplifier);
-
-	// verify calculated outputs
-	//std::cout << "verifing output 1" << std::endl;
-	//verify(items, "000000000000001110000010101000", 339815, 1 * amplifier);
-	//std::cout << "verifing output 2" << std::endl;
-	//verify(items, "010100100100001110000010101000", 603473, 3 * amplifier);
-	//std::cout << "verifing output 3" << std::endl;
-	//verify(items, "000000000000001010000000001000000010000000000000000001010000010010000100000001010010000000000001010100000000000000000000000000100000000000000000001000000010000100000010000101000001000000000000100000100000110000000010000000000000000001000000010000010000000000000010000010000000000000010000000100010000", 2512116, 3 * amplifier);
-
-	// create lookup table used on memoization
-	std::vector<std::vector<int>> lookup(items.size());
-	for (auto& weight_row : lookup)
-		weight_row.resize(max_weight + 1, -1);
-
-	// create stack trace table for tracking which items are selected
-	std::vector<std::vector<std::tuple<int, int, bool>>> activation(items.size());
-	for (auto& weight_row : activation)
-		weight_row.resize(max_weight + 1);
-
-	std::cout << "loading done" << std::endl;
-
-	auto start = high_resolution_clock::now();
-	// find max value using memoization with activation tracking
-	auto solution_trace = knapsack_dp_track_activation(items, lookup, activation, max_weight);
-	auto end = high_resolution_clock::now();
-	auto duration = (end - start).count();
-	std::cout << "took " << duration << " time" << std::endl;
-	std::cout << "memoization with tracing : " << solution_trace << " (" << (double)solution_trace / amplifier << ")" << std::endl;
-
-	std::cout << "item selection : ";
-	trace_activation(activation, max_weight);
-	std::cout << std::endl;
-
-	// find max value using memoization
-	auto solution = knapsack_dp(items, lookup, max_weight);
-	std::cout << "memoization : " << solution << " (" << (double)solution / amplifier << ")" << std::endl;
-
-	// find max value without using memoization
-	auto solution_raw = knapsack_dp_raw(items, max_weight);
-	std::cout << "raw : " << solution_raw << " (" << (double)solution_raw / amplifier << ")" << std::endl;
-}
\ No newline at end of file
+}
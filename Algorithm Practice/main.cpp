@@ -1,3 +1,752 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+#include <optional>
 #include "tsp.h"
-//#include "knapsack.h"
-//#include "dijkstra.h"
\ No newline at end of file
+#include "tsp_portfolio.h"
+#include "knapsack.h"
+#include "dijkstra.h"
+#include "point_to_point.h"
+#include "contraction_hierarchy.h"
+#include "external_graph.h"
+#include "profiling.h"
+#include "cache.h"
+
+// Command line options shared by all problems.
+// Problem specific options are ignored by the other problems.
+struct Options
+{
+	std::string problem;
+	std::string input_name;
+	// Engines to run one after another on the same input, for side by side comparison.
+	std::vector<std::string> engines;
+	int num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	// Seconds given to each engine. 0 means no limit.
+	// Engines that don't support early stop (e.g. knapsack, single pair queries) always run to completion.
+	double time_budget = 0;
+	// Weight (value) type of the solver kernels. auto picks the narrowest type that can't overflow on the input.
+	std::string weight_type = "auto";
+	// Chrome trace event output of the profiler. Only used when built with ENABLE_PROFILING.
+	std::string trace_file;
+	// Directory of cached intermediates and results. Empty disables the cache.
+	std::string cache_directory;
+
+	// knapsack
+	double capacity = 3;
+	int amplifier = 100000;
+
+	// dijkstra
+	int num_vertices = 0;
+	int num_groups = 1000;
+	int source = 12656;
+	int target = 4569;
+	// 0 uses the average edge weight.
+	double delta = 0;
+	int num_landmarks = 16;
+	std::string landmark_file;
+	std::string hierarchy_file;
+	std::string external_file;
+	int partition_size = 1 << 16;
+};
+
+void print_usage()
+{
+	std::cout
+		<< "usage : Algorithm Practice <problem> <input file> [options]\n"
+		<< "\n"
+		<< "problems and engines (--engine, comma separated, defaults to the first one) :\n"
+		<< "  tsp      : mst, evolve, branch_bound, portfolio (branch and bound raced against heuristics on --threads)\n"
+		<< "  knapsack : memo, trace, raw\n"
+		<< "  dijkstra : sweep, sweep_batch (longest shortest path over all pairs)\n"
+		<< "             dijkstra, delta_stepping, early_exit, bidirectional, alt, ch, external (single pair query)\n"
+		<< "             (ch falls back to bidirectional search on graphs without hierarchy, e.g. random graphs)\n"
+		<< "\n"
+		<< "common options :\n"
+		<< "  --engine <list>        engines to run side by side\n"
+		<< "  --threads <count>      worker threads (default : hardware concurrency)\n"
+		<< "  --time-budget <sec>    time limit of each engine, 0 for none (default : 0)\n"
+		<< "  --weight <type>        kernel weight type (default : auto)\n"
+		<< "                         tsp : float, double (auto = double)\n"
+		<< "                         knapsack : int16, int32, int64 (auto = narrowest holding the total value)\n"
+		<< "                         dijkstra : int32, int64, float, double (auto = int32 if every path weight fits, otherwise int64)\n"
+		<< "  --cache <directory>    reuse intermediates and results of earlier runs on the same input and parameters\n"
+		<< "  --trace <file>         write a chrome trace of profiled phases (builds with ENABLE_PROFILING only)\n"
+		<< "\n"
+		<< "knapsack options :\n"
+		<< "  --capacity <weight>    allowed weight budget (default : 3)\n"
+		<< "  --amplifier <scale>    real numbers are multiplied by this and rounded (default : 100000)\n"
+		<< "\n"
+		<< "dijkstra options :\n"
+		<< "  --vertices <count>     number of vertices, read from the input file if omitted\n"
+		<< "  --groups <count>       vertex groups processed one after another by sweep (default : 1000)\n"
+		<< "  --source <vertex>      query source (default : 12656)\n"
+		<< "  --target <vertex>      query target (default : 4569)\n"
+		<< "  --delta <width>        bucket width of delta_stepping (default : average edge weight)\n"
+		<< "  --landmarks <count>    number of alt landmarks (default : 16)\n"
+		<< "  --landmark-file <file> landmark cache, built on the first run (default : <input file>.landmarks)\n"
+		<< "  --hierarchy-file <file> contraction hierarchy cache (default : <input file>.ch)\n"
+		<< "  --external-file <file> binary graph used by external, converted on the first run (default : <input file>.csr)\n"
+		<< "  --partition-size <count> vertices per partition of the binary graph (default : 65536)\n";
+}
+
+std::vector<std::string> split(const std::string& list)
+{
+	auto result = std::vector<std::string>();
+	auto stream = std::stringstream(list);
+	auto item = std::string();
+	while (std::getline(stream, item, ','))
+		if (!item.empty())
+			result.push_back(item);
+	return result;
+}
+
+// Returns false on unknown or incomplete options.
+bool parse_options(int argc, char* argv[], Options& options)
+{
+	if (argc < 3)
+		return false;
+
+	options.problem = argv[1];
+	options.input_name = argv[2];
+	options.landmark_file = options.input_name + ".landmarks";
+	options.hierarchy_file = options.input_name + ".ch";
+	options.external_file = options.input_name + ".csr";
+
+	for (int i = 3; i < argc; i += 2)
+	{
+		if (i + 1 >= argc)
+			return false;
+
+		auto name = std::string(argv[i]);
+		auto value = std::string(argv[i + 1]);
+		if (name == "--engine")
+			options.engines = split(value);
+		else if (name == "--threads")
+			options.num_threads = std::max(1, std::atoi(value.c_str()));
+		else if (name == "--time-budget")
+			options.time_budget = std::atof(value.c_str());
+		else if (name == "--weight")
+			options.weight_type = value;
+		else if (name == "--trace")
+			options.trace_file = value;
+		else if (name == "--cache")
+			options.cache_directory = value;
+		else if (name == "--capacity")
+			options.capacity = std::atof(value.c_str());
+		else if (name == "--amplifier")
+			options.amplifier = std::atoi(value.c_str());
+		else if (name == "--vertices")
+			options.num_vertices = std::atoi(value.c_str());
+		else if (name == "--groups")
+			options.num_groups = std::atoi(value.c_str());
+		else if (name == "--source")
+			options.source = std::atoi(value.c_str());
+		else if (name == "--target")
+			options.target = std::atoi(value.c_str());
+		else if (name == "--delta")
+			options.delta = std::atof(value.c_str());
+		else if (name == "--landmarks")
+			options.num_landmarks = std::atoi(value.c_str());
+		else if (name == "--landmark-file")
+			options.landmark_file = value;
+		else if (name == "--hierarchy-file")
+			options.hierarchy_file = value;
+		else if (name == "--external-file")
+			options.external_file = value;
+		else if (name == "--partition-size")
+			options.partition_size = std::atoi(value.c_str());
+		else
+			return false;
+	}
+	return true;
+}
+
+// Runs each requested engine and prints its result with the elapsed time.
+// "engines" maps engine names to functions returning a printable result.
+// An engine receives the deadline computed from the time budget when it starts.
+using Engine = std::function<std::string(std::chrono::steady_clock::time_point)>;
+
+int run_engines(const Options& options, const std::vector<std::pair<std::string, Engine>>& engines)
+{
+	auto names = options.engines;
+	if (names.empty())
+		names.push_back(engines.front().first);
+
+	for (const auto& name : names)
+	{
+		auto engine = std::find_if(engines.begin(), engines.end(), [&](const auto& e) {
+			return e.first == name;
+			});
+		if (engine == engines.end())
+		{
+			std::cout << "unknown engine for " << options.problem << " : " << name << std::endl;
+			return 1;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		auto deadline = options.time_budget > 0
+			? start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.time_budget))
+			: std::chrono::steady_clock::time_point::max();
+		auto result = engine->second(deadline);
+		auto end = std::chrono::steady_clock::now();
+
+		std::cout << "[" << name << "] " << result
+			<< " (" << std::chrono::duration<double, std::milli>(end - start).count() << " ms)" << std::endl;
+	}
+	return 0;
+}
+
+// Cache entries of this run, keyed by the input file contents and the parameters each result depends on.
+// Disabled (every load misses) unless --cache is given.
+class ResultCache
+{
+public:
+	ResultCache(const Options& options)
+	{
+		auto hasher = cache::Hasher();
+		if (!options.cache_directory.empty() && hasher.add_file(options.input_name))
+		{
+			storage = cache::Cache(options.cache_directory);
+			input = hasher.add(options.problem).digest();
+		}
+	}
+
+	// Parameters must be raw values or std::string.
+	template<typename... Parameters>
+	std::uint64_t key(const std::string& kind, const Parameters&... parameters) const
+	{
+		auto hasher = cache::Hasher();
+		hasher.add(input).add(kind);
+		(hasher.add(parameters), ...);
+		return hasher.digest();
+	}
+
+	// Reads the values stored by store() with the same kind and key. Returns false on miss.
+	template<typename... Values>
+	bool load(const std::string& kind, std::uint64_t key, Values&... values) const
+	{
+		auto entry = storage.load(kind, key);
+		return entry && (entry->read(values) && ...);
+	}
+
+	template<typename... Values>
+	void store(const std::string& kind, std::uint64_t key, const Values&... values) const
+	{
+		auto writer = cache::Writer();
+		(writer.write(values), ...);
+		storage.store(kind, key, writer);
+	}
+
+private:
+	cache::Cache storage;
+	std::uint64_t input = 0;
+};
+
+template<typename Weight>
+int run_tsp(const Options& options, const std::vector<tsp::City>& cities)
+{
+	using namespace tsp;
+
+	auto results = ResultCache(options);
+	auto weight_size = sizeof(Weight);
+
+	// intermediates shared by the engines are loaded from the cache when possible.
+	auto table_key = results.key("tsp_distance_table", weight_size);
+	auto rows = std::vector<std::vector<Weight>>();
+	if (!results.load("tsp_distance_table", table_key, rows))
+	{
+		rows = DistanceTable<Weight>(cities).rows();
+		results.store("tsp_distance_table", table_key, rows);
+	}
+	auto distance_table = DistanceTable<Weight>(std::move(rows));
+
+	auto adjacency_key = results.key("tsp_adjacency_list");
+	auto adjacency_rows = std::vector<std::vector<Edge>>();
+	if (!results.load("tsp_adjacency_list", adjacency_key, adjacency_rows))
+	{
+		auto sorted = AdjacencyList(cities);
+		sorted.sort_by_weight();
+		adjacency_rows = sorted.rows();
+		results.store("tsp_adjacency_list", adjacency_key, adjacency_rows);
+	}
+	auto adjacency_list = AdjacencyList(std::move(adjacency_rows));
+
+	auto two_approximation_key = results.key("tsp_two_approximation");
+	auto cached_two_approximation = [&] {
+		auto path = std::vector<int>();
+		if (!results.load("tsp_two_approximation", two_approximation_key, path))
+		{
+			path = two_approximation(adjacency_list).cities();
+			results.store("tsp_two_approximation", two_approximation_key, path);
+		}
+		return Path(path);
+	};
+
+	auto describe = [&](const Path& path) {
+		auto output = std::stringstream();
+		output << "cost " << path.full_cost(distance_table) << ", path " << path;
+		return output.str();
+	};
+
+	// final tours are cached only when the engine finished within the time budget.
+	auto cached_result = [&](const std::string& engine, Deadline deadline, const std::function<Path(Deadline)>& solve) {
+		auto key = results.key("tsp_result", engine, weight_size);
+		auto path = std::vector<int>();
+		if (results.load("tsp_result", key, path))
+			return describe(Path(path)) + " (cached)";
+
+		auto result = solve(deadline);
+		if (std::chrono::steady_clock::now() < deadline)
+			results.store("tsp_result", key, result.cities());
+		return describe(result);
+	};
+
+	return run_engines(options, {
+		{ "mst", [&](Deadline deadline) {
+			return cached_result("mst", deadline, [&](Deadline) {
+				return cached_two_approximation();
+				});
+		} },
+		{ "evolve", [&](Deadline deadline) {
+			return cached_result("evolve", deadline, [&](Deadline deadline) {
+				auto path = cached_two_approximation();
+				path.evolve(distance_table, deadline);
+				return path;
+				});
+		} },
+		{ "branch_bound", [&](Deadline deadline) {
+			return cached_result("branch_bound", deadline, [&](Deadline deadline) {
+				PROFILE_SCOPE("tsp::branch_bound");
+				auto best_path = cached_two_approximation();
+				auto temp_path = Path(cities.size());
+				temp_path.push(0);
+				branch_bound(temp_path, best_path, distance_table, adjacency_list, deadline);
+				return best_path;
+				});
+		} },
+		{ "portfolio", [&](Deadline deadline) {
+			auto found_by = std::string();
+			auto description = cached_result("portfolio", deadline, [&](Deadline deadline) {
+				auto result = portfolio(distance_table, adjacency_list, options.num_threads, deadline);
+				found_by = ", found by " + result.found_by + (result.optimal ? " (optimal)" : "");
+				return result.path;
+				});
+			return description + found_by;
+		} },
+		});
+}
+
+// Distances are stored as double unless float is requested,
+// since the precision needed by a tour can't be known in advance.
+int run_tsp(const Options& options)
+{
+	auto cities = tsp::read_cities(options.input_name);
+	if (!cities)
+	{
+		std::cout << "can't read cities from " << options.input_name << " (lines of \"[city index] [x] [y]\", indices 0 ~ n - 1)" << std::endl;
+		return 1;
+	}
+	if (cities->empty())
+	{
+		std::cout << "no city in " << options.input_name << std::endl;
+		return 1;
+	}
+
+	if (options.weight_type == "float")
+		return run_tsp<float>(options, *cities);
+	if (options.weight_type == "double" || options.weight_type == "auto")
+		return run_tsp<double>(options, *cities);
+
+	std::cout << "unsupported weight type for tsp : " << options.weight_type << std::endl;
+	return 1;
+}
+
+template<typename Value>
+int run_knapsack(const Options& options, const std::vector<knapsack::Item>& items)
+{
+	using namespace knapsack;
+	using Deadline = std::chrono::steady_clock::time_point;
+
+	auto max_weight = static_cast<int>(std::round(options.capacity * options.amplifier));
+
+	auto describe = [&](std::int64_t value) {
+		return std::to_string(value) + " (" + std::to_string(static_cast<double>(value) / options.amplifier) + ")";
+	};
+
+	// every engine finds the same best value, which depends only on the items and the capacity.
+	// the item selection is cached along with it, since the selection is the expensive part of trace.
+	auto results = ResultCache(options);
+	auto key = results.key("knapsack_result", options.amplifier, max_weight);
+	auto cached_value = std::int64_t(0);
+	auto cached_selection = std::string();
+	auto cached = results.load("knapsack_result", key, cached_value, cached_selection);
+
+	return run_engines(options, {
+		{ "memo", [&](Deadline) {
+			if (cached)
+				return describe(cached_value) + " (cached)";
+
+			PROFILE_SCOPE("knapsack::memo");
+			auto lookup = make_lookup<Value>(items.size(), max_weight);
+			return describe(knapsack_dp(items, lookup, max_weight));
+		} },
+		{ "trace", [&](Deadline) {
+			if (cached)
+			{
+				std::cout << "item selection : " << cached_selection << std::endl;
+				return describe(cached_value) + " (cached)";
+			}
+
+			PROFILE_SCOPE("knapsack::trace");
+			// create stack trace table for tracking which items are selected
+			auto lookup = make_lookup<Value>(items.size(), max_weight);
+			auto activation = std::vector<std::vector<std::tuple<int, int, bool>>>(items.size(), std::vector<std::tuple<int, int, bool>>(max_weight + 1));
+			auto solution = knapsack_dp_track_activation(items, lookup, activation, max_weight);
+			auto item_selection = selection(activation, max_weight);
+			results.store("knapsack_result", key, static_cast<std::int64_t>(solution), item_selection);
+
+			std::cout << "item selection : " << item_selection << std::endl;
+			return describe(solution);
+		} },
+		{ "raw", [&](Deadline) {
+			if (cached)
+				return describe(cached_value) + " (cached)";
+
+			PROFILE_SCOPE("knapsack::raw");
+			return describe(knapsack_dp_raw(items, max_weight));
+		} },
+		});
+}
+
+// auto picks the narrowest integer type that holds the total value of all items.
+int run_knapsack(const Options& options)
+{
+	using namespace knapsack;
+
+	auto parsed = parse_file(options.input_name, options.amplifier);
+	if (!parsed)
+	{
+		std::cout << "can't read items from " << options.input_name << " (\"weight [...]\" and \"value [...]\" lines of the same length)" << std::endl;
+		return 1;
+	}
+	const auto& items = *parsed;
+	auto type = options.weight_type;
+	if (type == "auto")
+		type = fits_values<std::int16_t>(items) ? "int16" : fits_values<std::int32_t>(items) ? "int32" : "int64";
+	std::cout << "value type : " << type << std::endl;
+
+	if (type == "int16" && fits_values<std::int16_t>(items))
+		return run_knapsack<std::int16_t>(options, items);
+	if (type == "int32" && fits_values<std::int32_t>(items))
+		return run_knapsack<std::int32_t>(options, items);
+	if (type == "int64")
+		return run_knapsack<std::int64_t>(options, items);
+
+	std::cout << "total value doesn't fit in " << type << std::endl;
+	return 1;
+}
+
+// Hash of the input file contents. Preprocessed files built from the input (landmarks, hierarchy, external graph) store it,
+// so that a file built from an earlier version of the input is rebuilt instead of silently used.
+std::uint64_t input_hash(const Options& options)
+{
+	auto hasher = cache::Hasher();
+	hasher.add_file(options.input_name);
+	return hasher.digest();
+}
+
+template<typename Weight>
+using Graph = std::vector<std::vector<shortest_path::WeightedEdge<Weight>>>;
+
+// "load" reads the graph, or returns std::nullopt if the input can't be parsed with Weight weights.
+// It is only called when an engine other than external needs the graph,
+// so that external can run on graphs larger than memory when --vertices is given.
+template<typename Weight>
+int run_dijkstra(const Options& options, const ResultCache& results, const std::function<std::optional<Graph<Weight>>()>& load)
+{
+	using namespace shortest_path;
+
+	auto weight_type = std::string(std::is_floating_point_v<Weight> ? "float" : "int") + std::to_string(sizeof(Weight) * 8);
+	// every engine except external needs the graph in memory, and external needs its size unless --vertices is given.
+	auto needs_graph = options.num_vertices <= 0 || options.engines.empty()
+		|| std::any_of(options.engines.begin(), options.engines.end(), [](const auto& engine) {
+			return engine != "external";
+			});
+	auto graph = Graph<Weight>();
+	if (needs_graph)
+	{
+		auto loaded = load();
+		if (!loaded)
+		{
+			std::cout << "can't read " << options.input_name << " as \"[vertex1] [vertex2] [edge weight]\" lines with "
+				<< weight_type << " weights" << std::endl;
+			return 1;
+		}
+		graph = std::move(*loaded);
+		if (options.num_vertices > static_cast<int>(graph.size()))
+			graph.resize(options.num_vertices);
+	}
+	auto num_vertices = [&] {
+		return options.num_vertices > 0 ? options.num_vertices : static_cast<int>(graph.size());
+	};
+
+	auto describe_query = [&](Weight weight) {
+		auto output = std::stringstream();
+		output << options.source << " -> " << options.target << " : ";
+		if (weight == infinite<Weight>())
+			output << "unreachable";
+		else
+			output << weight;
+		return output.str();
+	};
+
+	// full SSSP results from options.source, shared by dijkstra, delta_stepping and early_exit.
+	// Only results cached by earlier runs are used, so engines of this run are still timed side by side.
+	auto sssp_key = results.key("dijkstra_sssp", weight_type, options.num_vertices, options.source);
+	auto cached_sssp = std::vector<Weight>();
+	auto has_sssp = results.load("dijkstra_sssp", sssp_key, cached_sssp) && options.target < static_cast<int>(cached_sssp.size());
+	auto sssp = [&](const std::function<std::vector<Weight>()>& solve) {
+		if (has_sssp)
+			return describe_query(cached_sssp[options.target]) + " (cached)";
+
+		auto path_weight = solve();
+		results.store("dijkstra_sssp", sssp_key, path_weight);
+		return describe_query(path_weight[options.target]);
+	};
+
+	// the sweep result is cached only when every source was examined within the time budget.
+	auto sweep_key = results.key("dijkstra_sweep", weight_type, options.num_vertices);
+	auto sweep = [&](bool use_batch, Deadline deadline) {
+		auto result = LongestShortestPath<Weight>();
+		auto cached = results.load("dijkstra_sweep", sweep_key, result);
+		if (!cached)
+		{
+			result = longest_shortest_path(graph, options.num_groups, options.num_threads, use_batch, deadline);
+			if (result.num_sources == static_cast<int>(graph.size()))
+				results.store("dijkstra_sweep", sweep_key, result);
+		}
+
+		auto output = std::stringstream();
+		output << result.source << " -> " << result.dest << " : " << result.weight
+			<< " (" << result.num_sources << " sources)" << (cached ? " (cached)" : "");
+		return output.str();
+	};
+
+	auto engines = std::vector<std::pair<std::string, Engine>>{
+		{ "sweep", [&](Deadline deadline) {
+			return sweep(false, deadline);
+		} },
+		{ "sweep_batch", [&](Deadline deadline) {
+			return sweep(true, deadline);
+		} },
+		{ "dijkstra", [&](Deadline) {
+			return sssp([&] {
+				return dijkstra(num_vertices(), options.source, graph);
+				});
+		} },
+		{ "delta_stepping", [&](Deadline) {
+			return sssp([&] {
+				auto delta = options.delta > 0 ? static_cast<Weight>(options.delta) : average_edge_weight(graph);
+				return delta_stepping(num_vertices(), options.source, graph, delta, options.num_threads);
+				});
+		} },
+		{ "early_exit", [&](Deadline) {
+			if (has_sssp)
+				return describe_query(cached_sssp[options.target]) + " (cached)";
+			return describe_query(dijkstra_to(num_vertices(), options.source, options.target, graph));
+		} },
+	};
+
+	// The point to point engines and the external graph are built on int weighted CsrGraph.
+	if constexpr (std::is_same_v<Weight, int>)
+	{
+		engines.push_back({ "bidirectional", [&](Deadline) {
+			return describe_query(PointToPoint(graph).bidirectional(options.source, options.target));
+		} });
+		engines.push_back({ "alt", [&](Deadline) {
+			// landmarks are loaded from landmark_file, or built and saved there on the first run.
+			auto queries = PointToPoint(graph);
+			queries.prepare_landmarks(options.landmark_file, options.num_landmarks, input_hash(options));
+			return describe_query(queries.distance(options.source, options.target));
+		} });
+		engines.push_back({ "ch", [&](Deadline) {
+			auto hierarchy = ContractionHierarchy();
+			auto graph_hash = input_hash(options);
+			if (!hierarchy.load(options.hierarchy_file, num_vertices(), graph_hash))
+			{
+				hierarchy = ContractionHierarchy(graph, options.num_threads);
+				hierarchy.save(options.hierarchy_file, graph_hash);
+			}
+			auto result = describe_query(hierarchy.distance(options.source, options.target));
+			return hierarchy.has_hierarchy() ? result : result + " (no hierarchy, bidirectional search)";
+		} });
+		engines.push_back({ "external", [&](Deadline) {
+			// reads edges from external_file one partition at a time instead of loading the whole graph into memory.
+			// external_file is converted from the input file on the first run.
+			auto external = ExternalCsrGraph();
+			auto graph_hash = input_hash(options);
+			if (!external.open(options.external_file, num_vertices(), graph_hash)
+				&& (!ExternalCsrGraph::convert(options.input_name, options.external_file, num_vertices(), options.partition_size, graph_hash)
+					|| !external.open(options.external_file, num_vertices(), graph_hash)))
+				return "can't convert " + options.input_name + " into " + options.external_file
+					+ " (unreadable input, vertex outside the graph or path weights beyond int32)";
+
+			auto path_weight = external_dijkstra(external, options.source);
+			if (!path_weight)
+				return "can't read partitions of " + options.external_file;
+			return describe_query((*path_weight)[options.target]);
+		} });
+	}
+	else
+	{
+		for (auto name : { "bidirectional", "alt", "ch", "external" })
+			engines.push_back({ name, [](Deadline) {
+				return std::string("only available with --weight int32");
+			} });
+	}
+
+	// every engine except the sweeps answers a query between source and target.
+	auto runs_query = std::any_of(options.engines.begin(), options.engines.end(), [](const auto& engine) {
+		return engine != "sweep" && engine != "sweep_batch";
+		});
+	if (runs_query && (options.source < 0 || options.source >= num_vertices() || options.target < 0 || options.target >= num_vertices()))
+	{
+		std::cout << "source and target must be vertices of the graph (0 ~ " << num_vertices() - 1 << ")" << std::endl;
+		return 1;
+	}
+
+	// an integer bucket width is truncated, e.g. 0.5 becomes 0 with int weights.
+	auto runs_delta_stepping = std::find(options.engines.begin(), options.engines.end(), "delta_stepping") != options.engines.end();
+	if (runs_delta_stepping && options.delta != 0 && !(static_cast<Weight>(options.delta) > Weight(0)))
+	{
+		std::cout << "delta must be positive in the weight type (given " << options.delta << ")" << std::endl;
+		return 1;
+	}
+
+	return run_engines(options, engines);
+}
+
+// auto reads weights as int64 and uses int32 if every shortest path weight fits in it.
+// If a weight isn't an integer (e.g. 2.5), the int64 read fails and auto uses double.
+// bidirectional, alt, ch and external are only available with int32 weights.
+int run_dijkstra(const Options& options)
+{
+	using namespace shortest_path;
+
+	if (!std::ifstream(options.input_name))
+	{
+		std::cout << "can't open " << options.input_name << std::endl;
+		return 1;
+	}
+	if (options.num_landmarks <= 0)
+	{
+		std::cout << "landmarks must be positive (given " << options.num_landmarks << ")" << std::endl;
+		return 1;
+	}
+
+	auto results = ResultCache(options);
+	auto type = options.weight_type;
+	auto edges = Graph<std::int64_t>();
+	auto real_edges = Graph<double>();
+	auto only_external = std::all_of(options.engines.begin(), options.engines.end(), [](const auto& engine) {
+		return engine == "external";
+		}) && !options.engines.empty();
+	auto type_key = results.key("dijkstra_weight_type", options.num_vertices);
+	if (type == "auto" && !results.load("dijkstra_weight_type", type_key, type))
+	{
+		if (only_external)
+		{
+			// external streams the input instead of loading it, and its conversion rejects path weights beyond int32.
+			type = "int32";
+		}
+		else if (auto integer_edges = load_graph<std::int64_t>(options.input_name))
+		{
+			edges = std::move(*integer_edges);
+			type = fits_path_weights<std::int32_t>(edges) ? "int32" : "int64";
+			results.store("dijkstra_weight_type", type_key, type);
+		}
+		else if (auto double_edges = load_graph<double>(options.input_name))
+		{
+			real_edges = std::move(*double_edges);
+			type = "double";
+			results.store("dijkstra_weight_type", type_key, type);
+		}
+		else
+		{
+			std::cout << "can't read " << options.input_name << " as \"[vertex1] [vertex2] [edge weight]\" lines" << std::endl;
+			return 1;
+		}
+	}
+	std::cout << "weight type : " << type << std::endl;
+
+	// the parsed graph is cached in binary form, which loads much faster than the text file.
+	auto loader = [&](auto weight) {
+		using Weight = decltype(weight);
+		return std::function<std::optional<Graph<Weight>>()>([&]() -> std::optional<Graph<Weight>> {
+			auto graph_key = results.key("dijkstra_graph", type);
+			auto graph = Graph<Weight>();
+			if (results.load("dijkstra_graph", graph_key, graph))
+				return graph;
+
+			// the graph read by auto is reused instead of parsing the text file again.
+			if (!edges.empty())
+				graph = convert_weights<Weight>(std::exchange(edges, {}));
+			else if (!real_edges.empty())
+				graph = convert_weights<Weight>(std::exchange(real_edges, {}));
+			else if (auto loaded = load_graph<Weight>(options.input_name))
+				graph = std::move(*loaded);
+			else
+				return std::nullopt;
+			results.store("dijkstra_graph", graph_key, graph);
+			return graph;
+			});
+	};
+
+	if (type == "int32")
+		return run_dijkstra<std::int32_t>(options, results, loader(std::int32_t()));
+	if (type == "int64")
+		return run_dijkstra<std::int64_t>(options, results, loader(std::int64_t()));
+	if (type == "float")
+		return run_dijkstra<float>(options, results, loader(float()));
+	if (type == "double")
+		return run_dijkstra<double>(options, results, loader(double()));
+
+	std::cout << "unsupported weight type for dijkstra : " << type << std::endl;
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	std::ios::sync_with_stdio(false);
+
+	auto options = Options();
+	if (!parse_options(argc, argv, options))
+	{
+		print_usage();
+		return 1;
+	}
+
+	if (!options.trace_file.empty())
+		PROFILE_TRACE_FILE(options.trace_file);
+
+	if (options.problem == "tsp")
+		return run_tsp(options);
+	if (options.problem == "knapsack")
+		return run_knapsack(options);
+	if (options.problem == "dijkstra")
+		return run_dijkstra(options);
+
+	print_usage();
+	return 1;
+}
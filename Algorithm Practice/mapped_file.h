@@ -0,0 +1,133 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a byte range in a file.
+// The OS requires mappings to start at a page (allocation granularity on windows) boundary,
+// so the actual mapping starts at the aligned position before "offset" and data() skips the gap.
+// Mapped pages are read from disk on first access and can be dropped by the OS under memory pressure,
+// which makes it suitable for streaming through files larger than memory.
+class MappedRegion
+{
+public:
+	MappedRegion() = default;
+
+	MappedRegion(const std::string& file_name, std::int64_t offset, std::size_t length)
+	{
+		if (length == 0)
+			return;
+
+		auto aligned_offset = offset - offset % granularity();
+		gap = static_cast<std::size_t>(offset - aligned_offset);
+		mapped_length = length + gap;
+
+#ifdef _WIN32
+		file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+			return;
+		auto view = MapViewOfFile(mapping, FILE_MAP_READ,
+			static_cast<DWORD>(aligned_offset >> 32), static_cast<DWORD>(aligned_offset & 0xFFFFFFFF), mapped_length);
+		base = static_cast<char*>(view);
+#else
+		file = open(file_name.c_str(), O_RDONLY);
+		if (file < 0)
+			return;
+		auto view = mmap(nullptr, mapped_length, PROT_READ, MAP_PRIVATE, file, aligned_offset);
+		if (view == MAP_FAILED)
+			return;
+		madvise(view, mapped_length, MADV_SEQUENTIAL);
+		base = static_cast<char*>(view);
+#endif
+	}
+
+	MappedRegion(const MappedRegion&) = delete;
+	MappedRegion& operator=(const MappedRegion&) = delete;
+
+	MappedRegion(MappedRegion&& other) noexcept
+	{
+		swap(other);
+	}
+
+	MappedRegion& operator=(MappedRegion&& other) noexcept
+	{
+		MappedRegion(std::move(other)).swap(*this);
+		return *this;
+	}
+
+	~MappedRegion()
+	{
+#ifdef _WIN32
+		if (base != nullptr)
+			UnmapViewOfFile(base);
+		if (mapping != nullptr)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+#else
+		if (base != nullptr)
+			munmap(base, mapped_length);
+		if (file >= 0)
+			close(file);
+#endif
+	}
+
+	// False if the file couldn't be opened or mapped.
+	// An empty range is always valid.
+	bool is_valid() const
+	{
+		return base != nullptr || mapped_length == 0;
+	}
+
+	const char* data() const
+	{
+		return base + gap;
+	}
+
+	static std::int64_t granularity()
+	{
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwAllocationGranularity;
+#else
+		return sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+private:
+	void swap(MappedRegion& other) noexcept
+	{
+		std::swap(file, other.file);
+#ifdef _WIN32
+		std::swap(mapping, other.mapping);
+#endif
+		std::swap(base, other.base);
+		std::swap(gap, other.gap);
+		std::swap(mapped_length, other.mapped_length);
+	}
+
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#else
+	int file = -1;
+#endif
+	char* base = nullptr;
+	std::size_t gap = 0;
+	std::size_t mapped_length = 0;
+};
@@ -0,0 +1,309 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <vector>
+#include <queue>
+#include <future>
+#include <algorithm>
+#include <cstdint>
+#include "dijkstra.h"
+
+namespace shortest_path
+{
+// Precomputed shortest path weights between a few landmark vertices and every other vertex (ALT preprocessing).
+// By triangle inequality, for any landmark L,
+//   dist(v, t) >= dist(L, t) - dist(L, v)
+//   dist(v, t) >= dist(v, L) - dist(t, L)
+// so the largest of these values over all landmarks is a lower bound of dist(v, t),
+// which can be used as A* heuristic.
+class Landmarks
+{
+public:
+	Landmarks() = default;
+
+	// Choose num_landmarks landmarks by farthest selection:
+	// each new landmark is the vertex whose nearest landmark is farthest away (unreachable vertices first).
+	// num_landmarks must be positive.
+	Landmarks(const CsrGraph& forward, const CsrGraph& backward, int num_landmarks)
+		: num_vertices(forward.size()), num_landmarks(num_landmarks)
+	{
+		assert(num_landmarks > 0);
+		// closest[v] : distance from the nearest landmark chosen so far.
+		// the first landmark is the vertex farthest from vertex 0.
+		auto closest = dijkstra(num_vertices, 0, forward);
+		for (int i = 0; i < num_landmarks; ++i)
+		{
+			auto landmark = static_cast<int>(std::max_element(closest.begin(), closest.end()) - closest.begin());
+			landmarks.push_back(landmark);
+
+			auto distance = dijkstra(num_vertices, landmark, forward);
+			for (int vertex = 0; vertex < num_vertices; ++vertex)
+				closest[vertex] = i == 0 ? distance[vertex] : std::min(closest[vertex], distance[vertex]);
+		}
+
+		from_landmark.resize(static_cast<size_t>(num_vertices) * num_landmarks);
+		to_landmark.resize(static_cast<size_t>(num_vertices) * num_landmarks);
+
+		auto results = std::vector<std::future<void>>();
+		for (int i = 0; i < num_landmarks; ++i)
+		{
+			results.emplace_back(std::async(std::launch::async, [&, i] {
+				auto from = dijkstra(num_vertices, landmarks[i], forward);
+				auto to = dijkstra(num_vertices, landmarks[i], backward);
+				for (int vertex = 0; vertex < num_vertices; ++vertex)
+				{
+					from_landmark[index(vertex, i)] = from[vertex];
+					to_landmark[index(vertex, i)] = to[vertex];
+				}
+				}));
+		}
+		for (auto& result : results)
+			result.get();
+	}
+
+	// Binary file layout : magic, graph_hash, num_vertices, num_landmarks, landmarks, from_landmark, to_landmark.
+	// graph_hash is a 64 bit hash of the input the graph was read from, and every other value is stored as raw int.
+	void save(const std::string& file_name, std::uint64_t graph_hash) const
+	{
+		auto output = std::ofstream(file_name, std::ios::binary);
+		auto write = [&](const int* data, size_t count) {
+			output.write(reinterpret_cast<const char*>(data), sizeof(int) * count);
+		};
+
+		write(&FILE_MAGIC, 1);
+		output.write(reinterpret_cast<const char*>(&graph_hash), sizeof(graph_hash));
+		write(&num_vertices, 1);
+		write(&num_landmarks, 1);
+		write(landmarks.data(), landmarks.size());
+		write(from_landmark.data(), from_landmark.size());
+		write(to_landmark.data(), to_landmark.size());
+	}
+
+	// Returns false if the file doesn't exist, is truncated,
+	// or was built for a different graph (other graph_hash or number of vertices).
+	// Landmarks of another graph would make an inadmissible heuristic, i.e. wrong distances.
+	bool load(const std::string& file_name, int expected_vertices, std::uint64_t graph_hash)
+	{
+		auto input = std::ifstream(file_name, std::ios::binary | std::ios::ate);
+		auto file_size = static_cast<std::int64_t>(input.tellg());
+		input.seekg(0);
+		auto read = [&](int* data, size_t count) {
+			return static_cast<bool>(input.read(reinterpret_cast<char*>(data), sizeof(int) * count));
+		};
+
+		int magic = 0;
+		auto stored_hash = std::uint64_t(0);
+		if (!read(&magic, 1) || magic != FILE_MAGIC)
+			return false;
+		if (!input.read(reinterpret_cast<char*>(&stored_hash), sizeof(stored_hash)) || stored_hash != graph_hash)
+			return false;
+		if (!read(&num_vertices, 1) || !read(&num_landmarks, 1) || num_vertices != expected_vertices)
+			return false;
+
+		// check the sizes against the file before allocating, since a corrupt header could ask for any amount of memory.
+		auto header_size = static_cast<std::int64_t>(sizeof(int) * 3 + sizeof(stored_hash));
+		auto expected_size = header_size + static_cast<std::int64_t>(sizeof(int)) * num_landmarks * (1 + 2 * static_cast<std::int64_t>(num_vertices));
+		if (num_landmarks <= 0 || expected_size != file_size)
+			return false;
+
+		landmarks.resize(num_landmarks);
+		from_landmark.resize(static_cast<size_t>(num_vertices) * num_landmarks);
+		to_landmark.resize(static_cast<size_t>(num_vertices) * num_landmarks);
+		return read(landmarks.data(), landmarks.size())
+			&& read(from_landmark.data(), from_landmark.size())
+			&& read(to_landmark.data(), to_landmark.size());
+	}
+
+	bool empty() const
+	{
+		return landmarks.empty();
+	}
+
+	// Lower bound of shortest path weight from vertex to target.
+	// Terms involving an unreachable pair give no information and are skipped.
+	int lower_bound(int vertex, int target) const
+	{
+		auto bound = 0;
+		for (int i = 0; i < num_landmarks; ++i)
+		{
+			auto from_vertex = from_landmark[index(vertex, i)];
+			auto from_target = from_landmark[index(target, i)];
+			if (from_vertex != INFINITE && from_target != INFINITE)
+				bound = std::max(bound, from_target - from_vertex);
+
+			auto to_vertex = to_landmark[index(vertex, i)];
+			auto to_target = to_landmark[index(target, i)];
+			if (to_vertex != INFINITE && to_target != INFINITE)
+				bound = std::max(bound, to_vertex - to_target);
+		}
+		return bound;
+	}
+
+private:
+	// "AL3". Older files ("ALT" with the old unreachable sentinel 999999999, "AL2" without graph_hash) are rebuilt.
+	static constexpr int FILE_MAGIC = 0x334c41;
+
+	// distances of a vertex to all landmarks are adjacent in memory,
+	// since lower_bound() reads them together.
+	size_t index(int vertex, int landmark) const
+	{
+		return static_cast<size_t>(vertex) * num_landmarks + landmark;
+	}
+
+	int num_vertices = 0;
+	int num_landmarks = 0;
+	std::vector<int> landmarks;
+	std::vector<int> from_landmark; // dist(landmark, vertex)
+	std::vector<int> to_landmark; // dist(vertex, landmark)
+};
+
+// Repeated shortest path queries between a pair of vertices on the same graph.
+// Search state is reused between queries and only the touched entries are reset,
+// so the cost of a query depends on the explored area rather than the graph size.
+// Since the state is shared, a single instance should not be queried from multiple threads at once.
+class PointToPoint
+{
+public:
+	PointToPoint(const std::vector<std::vector<Edge>>& edges)
+		: forward(edges), backward(forward.reverse()),
+		forward_weight(forward.size(), INFINITE), backward_weight(forward.size(), INFINITE)
+	{}
+
+	// Load landmarks from file_name, or build num_landmarks landmarks and save them to file_name if loading fails.
+	// graph_hash identifies the graph (e.g. a hash of its input file), so that landmarks of another graph are never loaded.
+	void prepare_landmarks(const std::string& file_name, int num_landmarks, std::uint64_t graph_hash)
+	{
+		PROFILE_SCOPE("shortest_path::prepare_landmarks");
+		if (!landmarks.load(file_name, forward.size(), graph_hash))
+		{
+			landmarks = Landmarks(forward, backward, num_landmarks);
+			landmarks.save(file_name, graph_hash);
+		}
+	}
+
+	// A* search with landmark heuristic if landmarks are prepared, bidirectional dijkstra otherwise.
+	int distance(int source, int target)
+	{
+		return landmarks.empty() ? bidirectional(source, target) : astar(source, target);
+	}
+
+	// Run dijkstra from source on the forward graph and from target on the backward graph at the same time,
+	// always advancing the side with smaller queue top.
+	// Once the sum of both queue tops reaches the best path found so far, no shorter path can exist.
+	// The sums add two path weights, each of which only fits in int on its own (see fits_path_weights()), so they saturate.
+	int bidirectional(int source, int target)
+	{
+		MinQueue forward_queue, backward_queue;
+		auto best = source == target ? 0 : INFINITE;
+
+		set_weight(forward_weight, source, 0);
+		set_weight(backward_weight, target, 0);
+		forward_queue.push({ 0, source });
+		backward_queue.push({ 0, target });
+
+		auto advance = [&](MinQueue& queue, const CsrGraph& graph, std::vector<int>& weight, const std::vector<int>& other_weight) {
+			auto [cost, next] = queue.top();
+			queue.pop();
+			if (cost > weight[next])
+				return;
+
+			for (const auto& [to, edge_weight] : graph[next])
+			{
+				auto new_weight = cost + edge_weight;
+				if (weight[to] > new_weight)
+				{
+					set_weight(weight, to, new_weight);
+					queue.push({ new_weight, to });
+					if (other_weight[to] != INFINITE)
+						best = std::min(best, add_weight(new_weight, other_weight[to]));
+				}
+			}
+		};
+
+		while (!forward_queue.empty() && !backward_queue.empty()
+			&& add_weight(forward_queue.top().first, backward_queue.top().first) < best)
+		{
+			if (forward_queue.top().first <= backward_queue.top().first)
+				advance(forward_queue, forward, forward_weight, backward_weight);
+			else
+				advance(backward_queue, backward, backward_weight, forward_weight);
+		}
+
+		reset();
+		return best;
+	}
+
+	// Dijkstra on the forward graph ordered by (path weight + landmark lower bound to target).
+	// The landmark bound is consistent, so target is final when popped.
+	int astar(int source, int target)
+	{
+		MinQueue queue;
+		auto best = INFINITE;
+
+		set_weight(forward_weight, source, 0);
+		queue.push({ landmarks.lower_bound(source, target), source });
+
+		while (!queue.empty())
+		{
+			auto [estimate, next] = queue.top();
+			queue.pop();
+
+			if (next == target)
+			{
+				best = forward_weight[target];
+				break;
+			}
+
+			auto cost = forward_weight[next];
+			if (estimate > add_weight(cost, landmarks.lower_bound(next, target)))
+				continue;
+
+			for (const auto& [to, edge_weight] : forward[next])
+			{
+				auto new_weight = cost + edge_weight;
+				if (forward_weight[to] > new_weight)
+				{
+					set_weight(forward_weight, to, new_weight);
+					queue.push({ add_weight(new_weight, landmarks.lower_bound(to, target)), to });
+				}
+			}
+		}
+
+		reset();
+		return best;
+	}
+
+private:
+	using MinQueue = std::priority_queue<
+		std::pair<int, int>,
+		std::vector<std::pair<int, int>>,
+		std::greater<std::pair<int, int>>
+	>;
+
+	void set_weight(std::vector<int>& weight, int vertex, int value)
+	{
+		if (weight[vertex] == INFINITE)
+			touched.push_back(vertex);
+		weight[vertex] = value;
+	}
+
+	void reset()
+	{
+		for (auto vertex : touched)
+		{
+			forward_weight[vertex] = INFINITE;
+			backward_weight[vertex] = INFINITE;
+		}
+		touched.clear();
+	}
+
+	CsrGraph forward;
+	CsrGraph backward;
+	Landmarks landmarks;
+
+	std::vector<int> forward_weight;
+	std::vector<int> backward_weight;
+	std::vector<int> touched;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,239 @@
+#pragma once
+
+// Instrumentation hooks for the solvers.
+//
+// PROFILE_SCOPE("name")          : times the enclosing scope as a phase.
+// PROFILE_COUNT("name", amount)  : adds amount to a per-thread event counter (relaxations, dp cells, ...).
+// PROFILE_TRACE_FILE(file_name)  : also writes every timed scope as chrome trace event JSON at exit
+//                                  (open with chrome://tracing or https://ui.perfetto.dev).
+//
+// Unless ENABLE_PROFILING is defined, every macro expands to nothing and the solvers compile exactly as before.
+// When enabled, a summary of phase times and counters is printed to std::cerr at exit.
+//
+// Names must be string literals (or otherwise live until exit), since only the pointer is kept.
+// Each call site looks its name up once, so the hot path is a thread_local access and an add.
+
+#ifdef ENABLE_PROFILING
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace profiling
+{
+constexpr int MAX_NAMES = 256;
+// Slot shared by every name registered after the table is full, so that they don't add to a real name.
+constexpr int OVERFLOW_NAME = MAX_NAMES - 1;
+
+// Time stamp counter of the current core.
+// Falls back to steady_clock nanoseconds on platforms without rdtsc.
+inline std::uint64_t ticks()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct Event
+{
+	int name;
+	std::uint64_t begin;
+	std::uint64_t end;
+};
+
+// Everything recorded by one thread. Only that thread writes to it, so no synchronization is needed until exit.
+struct ThreadData
+{
+	int index;
+	std::uint64_t counters[MAX_NAMES] = {};
+	std::uint64_t scope_ticks[MAX_NAMES] = {};
+	std::uint64_t scope_calls[MAX_NAMES] = {};
+	std::vector<Event> events;
+};
+
+// Owns the data of every thread that recorded something, including threads that have already finished,
+// and prints the summary when destroyed at exit.
+class Registry
+{
+public:
+	Registry()
+		: start_ticks(ticks()), start_time(std::chrono::steady_clock::now())
+	{}
+
+	~Registry()
+	{
+		auto ticks_per_us = calibrate();
+		print_summary(ticks_per_us);
+		if (!trace_file.empty())
+			write_trace(ticks_per_us);
+	}
+
+	int name_id(const char* name)
+	{
+		auto lock = std::lock_guard(mutex);
+		auto found = std::find(names.begin(), names.end(), name);
+		if (found != names.end())
+			return static_cast<int>(found - names.begin());
+		if (names.size() == OVERFLOW_NAME)
+		{
+			++dropped_names;
+			return OVERFLOW_NAME;
+		}
+		names.push_back(name);
+		return static_cast<int>(names.size()) - 1;
+	}
+
+	ThreadData* add_thread()
+	{
+		auto lock = std::lock_guard(mutex);
+		threads.push_back(std::make_unique<ThreadData>());
+		threads.back()->index = static_cast<int>(threads.size()) - 1;
+		return threads.back().get();
+	}
+
+	void set_trace_file(const std::string& file_name)
+	{
+		auto lock = std::lock_guard(mutex);
+		trace_file = file_name;
+	}
+
+private:
+	// Tick rate measured over the whole run, so that no sleep is needed at startup.
+	double calibrate() const
+	{
+		auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_time).count();
+		return elapsed > 0 ? (ticks() - start_ticks) / elapsed : 1.0;
+	}
+
+	const char* name_of(int name) const
+	{
+		return name == OVERFLOW_NAME ? "(names over the limit)" : names[name];
+	}
+
+	void print_summary(double ticks_per_us) const
+	{
+		std::cerr << "\n---- profile (" << threads.size() << " threads) ----\n";
+		if (dropped_names > 0)
+			std::cerr << dropped_names << " names over the limit of " << OVERFLOW_NAME << " are reported together as \"" << name_of(OVERFLOW_NAME) << "\"\n";
+
+		auto ids = std::vector<int>();
+		for (int name = 0; name < static_cast<int>(names.size()); ++name)
+			ids.push_back(name);
+		if (dropped_names > 0)
+			ids.push_back(OVERFLOW_NAME);
+
+		for (auto name : ids)
+		{
+			std::uint64_t total_ticks = 0, calls = 0, count = 0;
+			for (const auto& thread : threads)
+			{
+				total_ticks += thread->scope_ticks[name];
+				calls += thread->scope_calls[name];
+				count += thread->counters[name];
+			}
+			if (calls > 0)
+				std::cerr << name_of(name) << " : " << total_ticks / ticks_per_us / 1000.0 << " ms over " << calls << " calls\n";
+			if (count > 0)
+				std::cerr << name_of(name) << " : " << count << "\n";
+		}
+	}
+
+	void write_trace(double ticks_per_us) const
+	{
+		auto output = std::ofstream(trace_file);
+		output << "{\"traceEvents\": [\n";
+		auto first = true;
+		for (const auto& thread : threads)
+		{
+			for (const auto& event : thread->events)
+			{
+				output << (first ? "" : ",\n")
+					<< "  {\"name\": \"" << name_of(event.name) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread->index
+					<< ", \"ts\": " << (event.begin - start_ticks) / ticks_per_us
+					<< ", \"dur\": " << (event.end - event.begin) / ticks_per_us << "}";
+				first = false;
+			}
+		}
+		output << "\n]}\n";
+	}
+
+	std::mutex mutex;
+	std::vector<const char*> names;
+	// Number of names registered after the table was full.
+	int dropped_names = 0;
+	std::vector<std::unique_ptr<ThreadData>> threads;
+	std::string trace_file;
+	std::uint64_t start_ticks;
+	std::chrono::steady_clock::time_point start_time;
+};
+
+inline Registry& registry()
+{
+	static Registry instance;
+	return instance;
+}
+
+inline ThreadData& this_thread()
+{
+	thread_local ThreadData* data = registry().add_thread();
+	return *data;
+}
+
+class ScopedTimer
+{
+public:
+	ScopedTimer(int name)
+		: name(name), begin(ticks())
+	{}
+
+	~ScopedTimer()
+	{
+		auto end = ticks();
+		auto& data = this_thread();
+		data.scope_ticks[name] += end - begin;
+		++data.scope_calls[name];
+		data.events.push_back({ name, begin, end });
+	}
+
+private:
+	int name;
+	std::uint64_t begin;
+};
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name) \
+	static const int PROFILE_CONCAT(profile_name_, __LINE__) = profiling::registry().name_id(name); \
+	profiling::ScopedTimer PROFILE_CONCAT(profile_timer_, __LINE__)(PROFILE_CONCAT(profile_name_, __LINE__))
+
+#define PROFILE_COUNT(name, amount) \
+	do { \
+		static const int profile_name = profiling::registry().name_id(name); \
+		profiling::this_thread().counters[profile_name] += (amount); \
+	} while (false)
+
+#define PROFILE_TRACE_FILE(file_name) profiling::registry().set_trace_file(file_name)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNT(name, amount) do {} while (false)
+#define PROFILE_TRACE_FILE(file_name) do {} while (false)
+
+#endif
@@ -5,6 +5,19 @@
 #include <queue>
 #include <stack>
 #include <algorithm>
+#include <cmath>
+#include <string>
+#include <chrono>
+#include <type_traits>
+#include <utility>
+#include <optional>
+#include "profiling.h"
+
+namespace tsp
+{
+// Solvers that can take long stop early when this point in time is passed
+// and return the best solution found so far.
+using Deadline = std::chrono::steady_clock::time_point;
 
 template<typename T>
 using MinHeap = std::priority_queue<T, std::vector<T>, std::greater<T>>;
@@ -48,27 +61,45 @@ struct City
 	}
 };
 
+// Distance between every pair of cities, stored as Weight (float or double).
+// float halves the size of the table, which is read on every cost evaluation,
+// at the cost of about 7 significant digits per distance.
+// Sums of distances (e.g. Path::full_cost()) are always accumulated in double.
+template<typename Weight = double>
 class DistanceTable
 {
+	static_assert(std::is_floating_point_v<Weight>, "distances are real numbers");
+
 public:
 	DistanceTable(const std::vector<City>& cities)
 		: distance(cities.size())
 	{
+		PROFILE_SCOPE("tsp::distance_table");
 		for (auto& row : distance)
 			row.resize(cities.size());
 
 		for (const auto& src : cities)
 			for (const auto& dest : cities)
-				distance[src.id][dest.id] = src.distance(dest);
+				distance[src.id][dest.id] = static_cast<Weight>(src.distance(dest));
 	}
 
-	double operator()(int city1, int city2) const
+	// Table restored from rows() of a previously built one.
+	DistanceTable(std::vector<std::vector<Weight>> rows)
+		: distance(std::move(rows))
+	{}
+
+	Weight operator()(int city1, int city2) const
 	{
 		return distance[city1][city2];
 	}
 
+	const std::vector<std::vector<Weight>>& rows() const
+	{
+		return distance;
+	}
+
 private:
-	std::vector<std::vector<double>> distance;
+	std::vector<std::vector<Weight>> distance;
 };
 
 class AdjacencyList
@@ -78,9 +109,15 @@ public:
 		: adjacent_edges(size)
 	{}
 
+	// List restored from rows() of a previously built one.
+	AdjacencyList(std::vector<std::vector<Edge>> rows)
+		: adjacent_edges(std::move(rows))
+	{}
+
 	AdjacencyList(const std::vector<City>& cities)
 		: adjacent_edges(cities.size())
 	{
+		PROFILE_SCOPE("tsp::adjacency_list");
 		for (const auto& src : cities)
 			for (const auto& dest : cities)
 				if(src.id != dest.id)
@@ -103,6 +140,7 @@ public:
 
 	void sort_by_weight()
 	{
+		PROFILE_SCOPE("tsp::sort_by_weight");
 		for (auto& e : adjacent_edges)
 			std::sort(e.begin(), e.end(), [](const auto& lhs, const auto& rhs) {
 				return lhs.weight < rhs.weight;
@@ -119,6 +157,11 @@ public:
 		return adjacent_edges[src];
 	}
 
+	const std::vector<std::vector<Edge>>& rows() const
+	{
+		return adjacent_edges;
+	}
+
 private:
 	std::vector<std::vector<Edge>> adjacent_edges;
 };
@@ -134,6 +177,7 @@ public:
 
 	Graph mst()
 	{
+		PROFILE_SCOPE("tsp::mst");
 		auto connection = AdjacencyList(adjacency_list.size());
 		auto candidate = MinHeap<Edge>();
 		auto visited = std::vector<bool>(connection.size(), false);
@@ -165,6 +209,7 @@ public:
 
 	std::vector<int> preorder_traversal()
 	{
+		PROFILE_SCOPE("tsp::preorder_traversal");
 		auto result = std::vector<int>();
 		auto visited = std::vector<bool>(adjacency_list.size(), false);
 		auto stack = std::stack<int>();
@@ -238,10 +283,16 @@ public:
 		return visited[city];
 	}
 
-	double full_cost(const DistanceTable& distance) const
+	const std::vector<int>& cities() const
+	{
+		return path;
+	}
+
+	template<typename Weight>
+	double full_cost(const DistanceTable<Weight>& distance) const
 	{
 		double cost = 0.0;
-		for (int i = 0; i < path.size(); ++i)
+		for (int i = 0; i < static_cast<int>(path.size()); ++i)
 			cost += distance(path[i], path[(i + 1) % path.size()]);
 		return cost;
 	}
@@ -252,17 +303,20 @@ public:
 	}
 
 	// try all possible case of swapping two cities in path
-	// until no cost reduction happens.
-	void evolve(const DistanceTable& distance)
+	// until no cost reduction happens (or deadline is passed).
+	template<typename Weight>
+	void evolve(const DistanceTable<Weight>& distance, Deadline deadline = Deadline::max())
 	{
+		PROFILE_SCOPE("tsp::evolve");
 		auto current_cost = full_cost(distance);
-		while (true)
+		while (std::chrono::steady_clock::now() < deadline)
 		{
 			auto updated = false;
-			for (int i = 1; i < path.size(); ++i)
+			for (int i = 1; i < static_cast<int>(path.size()); ++i)
 			{
-				for (int j = i + 1; j < path.size(); ++j)
+				for (int j = i + 1; j < static_cast<int>(path.size()); ++j)
 				{
+					PROFILE_COUNT("tsp::swap_evaluations", 1);
 					std::swap(path[i], path[j]);
 					auto new_cost = full_cost(distance);
 					if (new_cost < current_cost)
@@ -288,12 +342,14 @@ public:
 		}
 	}
 
-	double lower_bound(const DistanceTable& distance, const AdjacencyList& adjacency_list) const
+	template<typename Weight>
+	double lower_bound(const DistanceTable<Weight>& distance, const AdjacencyList& adjacency_list) const
 	{
+		PROFILE_COUNT("tsp::bound_evaluations", 1);
 		double lb = 0.0;
 
 		// edge weights between visited cities
-		for(int i=0;i<path.size()-1;++i)
+		for(int i=0;i<static_cast<int>(path.size())-1;++i)
 			lb += distance(path[i], path[i + 1]);
 
 		// minimum edge cost for returning to first city
@@ -317,7 +373,7 @@ public:
 		}
 
 		// minimum adjacent edge cost for unvisited cities
-		for (int city = 0; city < visited.size(); ++city)
+		for (int city = 0; city < static_cast<int>(visited.size()); ++city)
 		{
 			if (!visited[city])
 			{
@@ -348,17 +404,23 @@ private:
 	std::vector<bool> visited;
 };
 
+template<typename Weight>
 void branch_bound(
 	Path& temp_path,
 	Path& best_path,
-	const DistanceTable& distance_table,
-	const AdjacencyList& adjacency_list
+	const DistanceTable<Weight>& distance_table,
+	const AdjacencyList& adjacency_list,
+	Deadline deadline = Deadline::max()
 )
 {
+	// give up the remaining branches once the time budget is used up.
+	// best_path still holds the best complete path found so far.
+	if (std::chrono::steady_clock::now() >= deadline)
+		return;
+
 	// debug info
 	static int call_count = 0;
 	static int prune_count = 0;
-	static unsigned long long removed = 0;
 	static int branch_length = 0;
 
 	// show progress
@@ -376,12 +438,12 @@ void branch_bound(
 	}
 
 	auto best_cost = best_path.full_cost(distance_table);
-	if (temp_path.length() == adjacency_list.size() - 1)
+	if (temp_path.length() == static_cast<int>(adjacency_list.size()) - 1)
 	{
 		auto cost = temp_path.lower_bound(distance_table, adjacency_list);
 
 		// add last unvisited city to path
-		for (int last_city = 0; last_city < adjacency_list.size(); ++last_city)
+		for (int last_city = 0; last_city < static_cast<int>(adjacency_list.size()); ++last_city)
 		{
 			if (!temp_path.is_visited(last_city))
 			{
@@ -397,7 +459,7 @@ void branch_bound(
 			std::cout << std::endl;
 			std::cout << "# new path found : " << cost << std::endl;
 			std::cout << "# path : " << best_path << std::endl;
-			best_path.evolve(distance_table);
+			best_path.evolve(distance_table, deadline);
 		}
 
 		// remove the last unvisited city.
@@ -409,7 +471,7 @@ void branch_bound(
 	{
 		// sort unvisited cities in ascending order of lower-bound
 		auto branch_order = std::vector<std::pair<double, int>>();
-		for (auto next_city = 0; next_city < adjacency_list.size(); ++next_city)
+		for (auto next_city = 0; next_city < static_cast<int>(adjacency_list.size()); ++next_city)
 		{
 			if (!temp_path.is_visited(next_city))
 			{
@@ -426,16 +488,18 @@ void branch_bound(
 		for (auto [lower_bound, next_city] : branch_order)
 		{
 			++call_count;
+			PROFILE_COUNT("tsp::branches", 1);
 			branch_length += temp_path.length();
 
 			temp_path.push(next_city);
 
 			if (lower_bound < best_cost)
 			{
-				branch_bound(temp_path, best_path, distance_table, adjacency_list);
+				branch_bound(temp_path, best_path, distance_table, adjacency_list, deadline);
 			}
 			else
 			{
+				PROFILE_COUNT("tsp::prunes", 1);
 				if(++prune_count % 1000000 == 0)
 					std::cout << temp_path << std::endl;
 			}
@@ -446,28 +510,38 @@ void branch_bound(
 	}
 }
 
-int main()
+// Cities in "[city index] [x coordinate] [y coordinate]" lines, until the end of file.
+// Cities are indexed by id, so ids must be exactly 0 ~ (number of cities - 1), in any order.
+// Returns std::nullopt if the file can't be opened, a line isn't "[city index] [x coordinate] [y coordinate]", or ids aren't as above.
+inline std::optional<std::vector<City>> read_cities(const std::string& file_name)
 {
-	std::ios::sync_with_stdio(false);
-
-	auto file = std::ifstream("100.tsp");
-	auto cities = std::vector<City>(100);
-	for (auto& city : cities)
-		file >> city;
-
-	auto distance_table = DistanceTable(cities);
-	auto adjacency_list = AdjacencyList(cities);
-	adjacency_list.sort_by_weight();
-
-	auto graph = Graph(adjacency_list);
-	auto mst = graph.mst();
-	auto two_approx = Path(mst.preorder_traversal());
+	PROFILE_SCOPE("tsp::read_cities");
+	auto file = std::ifstream(file_name);
+	if (!file)
+		return std::nullopt;
+
+	auto cities = std::vector<City>();
+	auto city = City();
+	while (file >> city)
+		cities.push_back(city);
+	if (!file.eof())
+		return std::nullopt;
+
+	auto seen = std::vector<bool>(cities.size(), false);
+	for (const auto& [id, x, y] : cities)
+	{
+		if (id < 0 || id >= static_cast<int>(cities.size()) || seen[id])
+			return std::nullopt;
+		seen[id] = true;
+	}
+	return cities;
+}
 
-	std::cout << two_approx << std::endl;
-	std::cout << two_approx.full_cost(distance_table) << std::endl;
+// Preorder traversal of the minimum spanning tree, which costs at most twice the optimal tour.
+// adjacency_list should be sorted by weight.
+inline Path two_approximation(const AdjacencyList& adjacency_list)
+{
+	return Path(Graph(adjacency_list).mst().preorder_traversal());
+}
 
-	auto best_path = two_approx;
-	auto temp_path = Path(cities.size());
-	temp_path.push(0);
-	branch_bound(temp_path, best_path, distance_table, adjacency_list);
-}
\ No newline at end of file
+}
@@ -0,0 +1,513 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <future>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <tuple>
+#include "tsp.h"
+#include "profiling.h"
+
+namespace tsp
+{
+// Best tour found so far, shared by every strategy of the portfolio without locks.
+//
+// The tour is published as an immutable Snapshot and replaced by compare-and-swap only if the new tour is cheaper,
+// so readers always see a complete tour and its cost together.
+// Replaced snapshots may still be read by other threads, so they are pushed to a lock-free retired list
+// and only freed when the incumbent itself is destroyed (after every strategy has finished).
+class Incumbent
+{
+public:
+	struct Snapshot
+	{
+		double cost;
+		std::vector<int> path;
+		// Name of the strategy that found the tour.
+		const char* found_by;
+		Snapshot* next_retired;
+	};
+
+	Incumbent() = default;
+	Incumbent(const Incumbent&) = delete;
+	Incumbent& operator=(const Incumbent&) = delete;
+
+	~Incumbent()
+	{
+		delete current.load();
+		auto snapshot = retired.load();
+		while (snapshot != nullptr)
+		{
+			auto next = snapshot->next_retired;
+			delete snapshot;
+			snapshot = next;
+		}
+	}
+
+	// Publishes the tour if it is cheaper than the current one. Returns true if it was published.
+	bool offer(const std::vector<int>& path, double cost, const char* found_by)
+	{
+		auto expected = current.load(std::memory_order_acquire);
+		if (expected != nullptr && expected->cost <= cost)
+			return false;
+
+		auto snapshot = new Snapshot{ cost, path, found_by, nullptr };
+		while (expected == nullptr || cost < expected->cost)
+		{
+			if (current.compare_exchange_weak(expected, snapshot, std::memory_order_acq_rel, std::memory_order_acquire))
+			{
+				retire(expected);
+				return true;
+			}
+		}
+		delete snapshot;
+		return false;
+	}
+
+	// Cost of the best tour, or infinity before the first offer.
+	double cost() const
+	{
+		auto snapshot = current.load(std::memory_order_acquire);
+		return snapshot != nullptr ? snapshot->cost : std::numeric_limits<double>::infinity();
+	}
+
+	// The snapshot stays valid until the incumbent is destroyed.
+	const Snapshot* best() const
+	{
+		return current.load(std::memory_order_acquire);
+	}
+
+private:
+	void retire(Snapshot* snapshot)
+	{
+		if (snapshot == nullptr)
+			return;
+		snapshot->next_retired = retired.load(std::memory_order_relaxed);
+		while (!retired.compare_exchange_weak(snapshot->next_retired, snapshot, std::memory_order_release, std::memory_order_relaxed))
+			;
+	}
+
+	std::atomic<Snapshot*> current = nullptr;
+	std::atomic<Snapshot*> retired = nullptr;
+};
+
+// Tour cost with the last city connected back to the first.
+template<typename Weight>
+double tour_cost(const std::vector<int>& path, const DistanceTable<Weight>& distance)
+{
+	double cost = 0.0;
+	for (size_t i = 0; i < path.size(); ++i)
+		cost += distance(path[i], path[(i + 1) % path.size()]);
+	return cost;
+}
+
+// Improve the tour with 2-opt moves (reversing a segment) until no move reduces the cost, stop is set or deadline is passed.
+// Each move is evaluated from the four edges it changes, instead of recomputing the whole tour.
+// A pass over every move is quadratic in the number of cities, so stop and deadline are checked for every i instead of every pass.
+template<typename Weight>
+void two_opt(std::vector<int>& path, const DistanceTable<Weight>& distance, const std::atomic<bool>& stop, Deadline deadline)
+{
+	auto size = static_cast<int>(path.size());
+	auto improved = true;
+	while (improved)
+	{
+		improved = false;
+		for (int i = 1; i < size - 1; ++i)
+		{
+			if (stop.load(std::memory_order_relaxed) || std::chrono::steady_clock::now() >= deadline)
+				return;
+			for (int j = i + 1; j < size; ++j)
+			{
+				PROFILE_COUNT("tsp::two_opt_moves", 1);
+				auto a = path[i - 1], b = path[i], c = path[j], d = path[(j + 1) % size];
+				auto delta = static_cast<double>(distance(a, c)) + distance(b, d) - distance(a, b) - distance(c, d);
+				if (delta < -1e-9)
+				{
+					std::reverse(path.begin() + i, path.begin() + j + 1);
+					improved = true;
+				}
+			}
+		}
+	}
+}
+
+// Tour visiting the nearest unvisited city next, starting from start.
+// The tour is rotated to start at city 0 like every other tour of this file.
+// Returns an empty tour if deadline is passed before the tour is complete.
+template<typename Weight>
+std::vector<int> nearest_neighbour(int start, const DistanceTable<Weight>& distance, int num_cities, Deadline deadline)
+{
+	auto path = std::vector<int>{ start };
+	auto visited = std::vector<bool>(num_cities, false);
+	visited[start] = true;
+	for (int step = 1; step < num_cities; ++step)
+	{
+		if (std::chrono::steady_clock::now() >= deadline)
+			return {};
+		auto best = -1;
+		for (int city = 0; city < num_cities; ++city)
+			if (!visited[city] && (best == -1 || distance(path.back(), city) < distance(path.back(), best)))
+				best = city;
+		visited[best] = true;
+		path.push_back(best);
+	}
+	std::rotate(path.begin(), std::find(path.begin(), path.end(), 0), path.end());
+	return path;
+}
+
+// Greedy edge construction : take edges in ascending order of weight,
+// skipping edges that would give a city a third edge or close a cycle before every city is connected.
+// adjacency_list should be sorted by weight.
+// Returns an empty path if deadline is passed before the tour is complete.
+inline std::vector<int> greedy_edge(const AdjacencyList& adjacency_list, Deadline deadline = Deadline::max())
+{
+	auto num_cities = static_cast<int>(adjacency_list.size());
+	if (num_cities < 3)
+	{
+		auto path = std::vector<int>(num_cities);
+		std::iota(path.begin(), path.end(), 0);
+		return path;
+	}
+
+	// edges are merged lazily from the sorted rows (weight, city, position in the row of city)
+	// instead of sorting all O(number of cities ^ 2) edges up front, so the deadline is checked while edges are taken.
+	// Each edge is taken from the row of its smaller city only.
+	auto next_edges = MinHeap<std::tuple<double, int, int>>();
+	auto push_next = [&](int city, int position) {
+		const auto& row = adjacency_list[city];
+		while (position < static_cast<int>(row.size()) && row[position].dest < city)
+			++position;
+		if (position < static_cast<int>(row.size()))
+			next_edges.push({ row[position].weight, city, position });
+	};
+	for (int city = 0; city < num_cities; ++city)
+		push_next(city, 0);
+
+	// union-find over path fragments to detect cycles.
+	auto parent = std::vector<int>(num_cities);
+	std::iota(parent.begin(), parent.end(), 0);
+	auto find = [&](int city) {
+		while (parent[city] != city)
+			city = parent[city] = parent[parent[city]];
+		return city;
+	};
+
+	auto degree = std::vector<int>(num_cities, 0);
+	auto neighbours = std::vector<std::vector<int>>(num_cities);
+	constexpr auto DEADLINE_CHECK_INTERVAL = 1024;
+	auto num_edges = 0;
+	for (auto taken = 1; !next_edges.empty(); ++taken)
+	{
+		if (taken % DEADLINE_CHECK_INTERVAL == 0 && std::chrono::steady_clock::now() >= deadline)
+			return {};
+
+		auto [weight, city, position] = next_edges.top();
+		next_edges.pop();
+		push_next(city, position + 1);
+		auto src = city;
+		auto dest = adjacency_list[city][position].dest;
+		if (degree[src] == 2 || degree[dest] == 2)
+			continue;
+		if (find(src) == find(dest) && num_edges != num_cities - 1)
+			continue;
+
+		parent[find(src)] = find(dest);
+		++degree[src];
+		++degree[dest];
+		neighbours[src].push_back(dest);
+		neighbours[dest].push_back(src);
+		if (++num_edges == num_cities)
+			break;
+	}
+
+	// walk the cycle from city 0.
+	auto path = std::vector<int>{ 0 };
+	auto previous = -1;
+	while (static_cast<int>(path.size()) < num_cities)
+	{
+		auto current = path.back();
+		auto next = neighbours[current][0] != previous ? neighbours[current][0] : neighbours[current][1];
+		previous = current;
+		path.push_back(next);
+	}
+	return path;
+}
+
+// Order in which branch and bound tries the unvisited cities of a branch.
+enum class ChildOrder
+{
+	// ascending lower bound of the extended path (same as branch_bound()).
+	LowerBound,
+	// ascending distance from the last city of the path.
+	Nearest,
+	// random order, different for each seed.
+	Shuffled,
+};
+
+// Thread-safe branch and bound pruning against the shared incumbent.
+// Unlike branch_bound(), it keeps no static state, and complete tours are published with their exact cost.
+// Returns true if the whole search tree was explored, which proves the incumbent optimal.
+template<typename Weight>
+class PortfolioBranchBound
+{
+public:
+	PortfolioBranchBound(const DistanceTable<Weight>& distance, const AdjacencyList& adjacency_list,
+		Incumbent& incumbent, ChildOrder order, unsigned seed, const std::atomic<bool>& stop, Deadline deadline)
+		: distance(distance), adjacency_list(adjacency_list), incumbent(incumbent), order(order),
+		random(seed), stop(stop), deadline(deadline)
+	{}
+
+	bool run()
+	{
+		auto path = Path(adjacency_list.size());
+		path.push(0);
+		search(path);
+		return !interrupted;
+	}
+
+private:
+	// the clock is read once this much work (roughly steps over cities) has been done since the last read.
+	static constexpr long long DEADLINE_CHECK_WORK = 1 << 16;
+
+	bool should_stop(long long work = 1)
+	{
+		if (interrupted)
+			return true;
+		work_since_check += work;
+		if (stop.load(std::memory_order_relaxed))
+			interrupted = true;
+		else if (work_since_check >= DEADLINE_CHECK_WORK)
+		{
+			work_since_check = 0;
+			interrupted = std::chrono::steady_clock::now() >= deadline;
+		}
+		return interrupted;
+	}
+
+	void search(Path& path)
+	{
+		if (should_stop())
+			return;
+
+		auto num_cities = static_cast<int>(adjacency_list.size());
+		if (path.length() == num_cities)
+		{
+			auto tour = Path(path);
+			incumbent.offer(tour.cities(), tour.full_cost(distance), name());
+			return;
+		}
+
+		auto children = std::vector<std::pair<double, int>>();
+		for (int city = 0; city < num_cities; ++city)
+		{
+			if (path.is_visited(city))
+				continue;
+
+			path.push(city);
+			auto bound = path.length() == num_cities ? path.full_cost(distance) : path.lower_bound(distance, adjacency_list);
+			path.pop();
+			children.emplace_back(bound, city);
+
+			// a bound costs O(number of cities), so large instances read the clock after a few bounds.
+			if (should_stop(num_cities))
+				return;
+		}
+
+		if (order == ChildOrder::LowerBound)
+		{
+			std::sort(children.begin(), children.end());
+		}
+		else if (order == ChildOrder::Nearest)
+		{
+			auto last = path.back();
+			std::sort(children.begin(), children.end(), [&](const auto& lhs, const auto& rhs) {
+				return distance(last, lhs.second) < distance(last, rhs.second);
+				});
+		}
+		else
+		{
+			std::shuffle(children.begin(), children.end(), random);
+		}
+
+		for (auto [bound, city] : children)
+		{
+			// the incumbent is read again for every child, since other strategies may have improved it meanwhile.
+			if (bound >= incumbent.cost())
+			{
+				PROFILE_COUNT("tsp::portfolio_prunes", 1);
+				continue;
+			}
+
+			PROFILE_COUNT("tsp::portfolio_branches", 1);
+			path.push(city);
+			search(path);
+			path.pop();
+			if (interrupted)
+				return;
+		}
+	}
+
+	const char* name() const
+	{
+		switch (order)
+		{
+		case ChildOrder::LowerBound: return "branch_bound(lower_bound)";
+		case ChildOrder::Nearest: return "branch_bound(nearest)";
+		default: return "branch_bound(shuffled)";
+		}
+	}
+
+	const DistanceTable<Weight>& distance;
+	const AdjacencyList& adjacency_list;
+	Incumbent& incumbent;
+	ChildOrder order;
+	std::mt19937 random;
+	const std::atomic<bool>& stop;
+	Deadline deadline;
+	long long work_since_check = 0;
+	bool interrupted = false;
+};
+
+// Randomized restarts of 2-opt local search until stop is set or deadline is passed.
+// Each restart kicks the current incumbent with a random double bridge move (which 2-opt can't undo in one step),
+// or starts from a random tour every few restarts, to leave the local optimum.
+template<typename Weight>
+void local_search_restarts(const DistanceTable<Weight>& distance, int num_cities,
+	Incumbent& incumbent, unsigned seed, const std::atomic<bool>& stop, Deadline deadline)
+{
+	PROFILE_SCOPE("tsp::portfolio_local_search");
+	auto random = std::mt19937(seed);
+	for (auto restart = 0; !stop.load(std::memory_order_relaxed) && std::chrono::steady_clock::now() < deadline; ++restart)
+	{
+		auto best = incumbent.best();
+		auto path = std::vector<int>();
+		if (best == nullptr || restart % 8 == 0 || num_cities < 8)
+		{
+			path.resize(num_cities);
+			std::iota(path.begin(), path.end(), 0);
+			std::shuffle(path.begin() + 1, path.end(), random);
+		}
+		else
+		{
+			// double bridge : cut the tour into A B C D and reconnect as A C B D.
+			path = best->path;
+			auto cut = std::uniform_int_distribution<int>(1, num_cities - 1);
+			int cuts[3] = { cut(random), cut(random), cut(random) };
+			std::sort(std::begin(cuts), std::end(cuts));
+			auto kicked = std::vector<int>(path.begin(), path.begin() + cuts[0]);
+			kicked.insert(kicked.end(), path.begin() + cuts[1], path.begin() + cuts[2]);
+			kicked.insert(kicked.end(), path.begin() + cuts[0], path.begin() + cuts[1]);
+			kicked.insert(kicked.end(), path.begin() + cuts[2], path.end());
+			path = std::move(kicked);
+		}
+
+		two_opt(path, distance, stop, deadline);
+		incumbent.offer(path, tour_cost(path, distance), "local_search");
+	}
+}
+
+// Nearest neighbour tours from every start city and the greedy edge tour, each improved by 2-opt.
+template<typename Weight>
+void construction(const DistanceTable<Weight>& distance, const AdjacencyList& adjacency_list,
+	Incumbent& incumbent, const std::atomic<bool>& stop, Deadline deadline)
+{
+	PROFILE_SCOPE("tsp::portfolio_construction");
+	auto num_cities = static_cast<int>(adjacency_list.size());
+
+	auto path = greedy_edge(adjacency_list, deadline);
+	if (!path.empty())
+	{
+		two_opt(path, distance, stop, deadline);
+		incumbent.offer(path, tour_cost(path, distance), "greedy_edge");
+	}
+
+	for (int start = 0; start < num_cities && !stop.load(std::memory_order_relaxed) && std::chrono::steady_clock::now() < deadline; ++start)
+	{
+		path = nearest_neighbour(start, distance, num_cities, deadline);
+		if (path.empty())
+			break;
+		two_opt(path, distance, stop, deadline);
+		incumbent.offer(path, tour_cost(path, distance), "nearest_neighbour");
+	}
+}
+
+struct PortfolioResult
+{
+	Path path;
+	double cost;
+	// Name of the strategy that found the returned tour.
+	std::string found_by;
+	// True if a branch and bound strategy explored its whole tree, i.e. no cheaper tour exists.
+	bool optimal;
+};
+
+// Runs several strategies on num_threads threads at the same time, all publishing into one Incumbent :
+//   thread 0 : branch and bound, children in lower bound order
+//   thread 1 : greedy edge / nearest neighbour construction, then local search restarts
+//   thread 2 : branch and bound, nearest child first
+//   thread 3, 5, ... : local search restarts with different seeds
+//   thread 4, 6, ... : branch and bound, shuffled children with different seeds
+// Good tours from the heuristics tighten the pruning of every branch and bound immediately.
+// Everything stops as soon as any branch and bound finishes (proving the optimum), or when deadline is passed.
+// adjacency_list should be sorted by weight.
+template<typename Weight>
+PortfolioResult portfolio(const DistanceTable<Weight>& distance, const AdjacencyList& adjacency_list,
+	int num_threads, Deadline deadline = Deadline::max())
+{
+	PROFILE_SCOPE("tsp::portfolio");
+	auto num_cities = static_cast<int>(adjacency_list.size());
+	auto incumbent = Incumbent();
+	auto stop = std::atomic<bool>(false);
+	auto optimal = std::atomic<bool>(false);
+
+	// a nearest neighbour tour gives every strategy a bound to start from.
+	// It takes O(number of cities ^ 2) like a single 2-opt pass, whereas two_approximation() pushes every edge of the complete graph through a heap
+	// and alone could use up a short time budget on large instances.
+	// If even that passes the deadline, the tour in city order keeps the result valid.
+	auto start = nearest_neighbour(0, distance, num_cities, deadline);
+	if (start.empty())
+	{
+		start.resize(num_cities);
+		std::iota(start.begin(), start.end(), 0);
+	}
+	incumbent.offer(start, tour_cost(start, distance), "nearest_neighbour");
+
+	auto branch_bound = [&](ChildOrder order, unsigned seed) {
+		PROFILE_SCOPE("tsp::portfolio_branch_bound");
+		if (PortfolioBranchBound<Weight>(distance, adjacency_list, incumbent, order, seed, stop, deadline).run())
+		{
+			optimal.store(true);
+			stop.store(true);
+		}
+	};
+
+	auto results = std::vector<std::future<void>>();
+	for (int t = 0; t < std::max(1, num_threads); ++t)
+	{
+		auto seed = static_cast<unsigned>(t);
+		results.emplace_back(std::async(std::launch::async, [&, t, seed] {
+			if (t == 0)
+				branch_bound(ChildOrder::LowerBound, seed);
+			else if (t == 1)
+			{
+				construction(distance, adjacency_list, incumbent, stop, deadline);
+				local_search_restarts(distance, num_cities, incumbent, seed, stop, deadline);
+			}
+			else if (t == 2)
+				branch_bound(ChildOrder::Nearest, seed);
+			else if (t % 2 == 1)
+				local_search_restarts(distance, num_cities, incumbent, seed, stop, deadline);
+			else
+				branch_bound(ChildOrder::Shuffled, seed);
+			}));
+	}
+	for (auto& result : results)
+		result.get();
+
+	auto best = incumbent.best();
+	return { Path(best->path), best->cost, best->found_by, optimal.load() };
+}
+
+}
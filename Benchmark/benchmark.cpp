@@ -0,0 +1,278 @@
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include "harness.h"
+#include "generators.h"
+
+// Count every heap allocation made by the process.
+// Harness reads the counters before and after a task to report allocations per run and the peak heap size.
+std::atomic<std::uint64_t> harness::allocation_count = 0;
+std::atomic<std::uint64_t> harness::allocated_bytes = 0;
+std::atomic<std::uint64_t> harness::live_bytes = 0;
+std::atomic<std::uint64_t> harness::peak_live_bytes = 0;
+
+namespace
+{
+// Stored right before every allocation, so that delete knows the size without relying on sized deallocation
+// and can free the block even when it was over-aligned.
+struct AllocationHeader
+{
+	void* base;
+	std::size_t size;
+};
+
+void* allocate(std::size_t size, std::size_t alignment)
+{
+	alignment = std::max<std::size_t>(alignment, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+	auto base = std::malloc(size + sizeof(AllocationHeader) + alignment);
+	if (base == nullptr)
+		return nullptr;
+
+	auto address = reinterpret_cast<std::uintptr_t>(base) + sizeof(AllocationHeader);
+	address = (address + alignment - 1) / alignment * alignment;
+	auto pointer = reinterpret_cast<void*>(address);
+	static_cast<AllocationHeader*>(pointer)[-1] = { base, size };
+	harness::record_allocation(size);
+	return pointer;
+}
+
+void* allocate_or_throw(std::size_t size, std::size_t alignment)
+{
+	if (auto pointer = allocate(size, alignment))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void deallocate(void* pointer) noexcept
+{
+	if (pointer == nullptr)
+		return;
+	auto header = static_cast<AllocationHeader*>(pointer)[-1];
+	harness::record_deallocation(header.size);
+	std::free(header.base);
+}
+}
+
+// Every form is replaced, so that no pointer from the library allocator reaches deallocate() or the other way around.
+void* operator new(std::size_t size) { return allocate_or_throw(size, 0); }
+void* operator new[](std::size_t size) { return allocate_or_throw(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate_or_throw(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocate_or_throw(size, static_cast<std::size_t>(alignment)); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* pointer) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(pointer); }
+
+void benchmark_tsp(harness::Benchmark& benchmark)
+{
+	using namespace tsp;
+
+	auto instances = std::vector<std::pair<std::string, std::vector<City>>>{
+		{ "uniform_200", generator::uniform_cities(200, 1) },
+		{ "clustered_200", generator::clustered_cities(200, 8, 1) },
+	};
+	for (const auto& [name, cities] : instances)
+	{
+		benchmark.run("tsp", name, "mst_2approx", [&] {
+			auto adjacency_list = AdjacencyList(cities);
+			adjacency_list.sort_by_weight();
+			auto two_approx = Path(Graph(adjacency_list).mst().preorder_traversal());
+			harness::sink = two_approx.length();
+		});
+
+		auto distance_table = DistanceTable(cities);
+		auto adjacency_list = AdjacencyList(cities);
+		adjacency_list.sort_by_weight();
+		auto two_approx = Path(Graph(adjacency_list).mst().preorder_traversal());
+		benchmark.run("tsp", name, "evolve", [&] {
+			auto path = two_approx;
+			path.evolve(distance_table);
+			harness::sink = static_cast<std::int64_t>(path.full_cost(distance_table));
+		});
+	}
+
+	// branch and bound is exponential, so it gets much smaller instances.
+	auto small_instances = std::vector<std::pair<std::string, std::vector<City>>>{
+		{ "uniform_11", generator::uniform_cities(11, 2) },
+		{ "clustered_11", generator::clustered_cities(11, 3, 2) },
+	};
+	for (const auto& [name, cities] : small_instances)
+	{
+		benchmark.run("tsp", name, "branch_bound", [&] {
+			auto distance_table = DistanceTable(cities);
+			auto adjacency_list = AdjacencyList(cities);
+			adjacency_list.sort_by_weight();
+
+			auto best_path = Path(Graph(adjacency_list).mst().preorder_traversal());
+			auto temp_path = Path(cities.size());
+			temp_path.push(0);
+			branch_bound(temp_path, best_path, distance_table, adjacency_list);
+			harness::sink = static_cast<std::int64_t>(best_path.full_cost(distance_table));
+		});
+
+		benchmark.run("tsp", name, "portfolio", [&] {
+			auto distance_table = DistanceTable(cities);
+			auto adjacency_list = AdjacencyList(cities);
+			adjacency_list.sort_by_weight();
+
+			auto result = portfolio(distance_table, adjacency_list, static_cast<int>(std::thread::hardware_concurrency()));
+			harness::sink = static_cast<std::int64_t>(result.cost);
+		});
+	}
+}
+
+void benchmark_knapsack(harness::Benchmark& benchmark)
+{
+	using namespace knapsack;
+
+	constexpr auto amplifier = 1000;
+	auto max_weight = 3 * amplifier;
+
+	for (auto count : { 30, 300 })
+	{
+		auto items = generator::correlated_items(count, amplifier, 1);
+		auto name = "correlated_" + std::to_string(count);
+
+		benchmark.run("knapsack", name, "dp_memo", [&] {
+			auto lookup = make_lookup(items.size(), max_weight);
+			harness::sink = knapsack_dp(items, lookup, max_weight);
+		});
+
+		benchmark.run("knapsack", name, "dp_trace", [&] {
+			auto lookup = make_lookup(items.size(), max_weight);
+			auto activation = std::vector<std::vector<std::tuple<int, int, bool>>>(items.size(), std::vector<std::tuple<int, int, bool>>(max_weight + 1));
+			harness::sink = knapsack_dp_track_activation(items, lookup, activation, max_weight);
+		});
+	}
+
+	// raw recursion is exponential, so it gets a much smaller instance.
+	auto items = generator::correlated_items(20, amplifier, 1);
+	benchmark.run("knapsack", "correlated_20", "raw", [&] {
+		harness::sink = knapsack_dp_raw(items, max_weight);
+	});
+}
+
+void benchmark_dijkstra(harness::Benchmark& benchmark)
+{
+	using namespace shortest_path;
+
+	auto num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	auto instances = std::vector<std::pair<std::string, std::vector<std::vector<Edge>>>>{
+		{ "random_10000", generator::random_graph(10000, 4, 20, 1) },
+		{ "grid_100x100", generator::grid_graph(100, 100, 20, 1) },
+	};
+	for (const auto& [name, edges] : instances)
+	{
+		auto num_vertices = static_cast<int>(edges.size());
+
+		// sources and pairs are spread evenly so every solver sees the same queries.
+		auto sources = std::array<int, BATCH_WIDTH>();
+		for (int lane = 0; lane < BATCH_WIDTH; ++lane)
+			sources[lane] = lane * num_vertices / BATCH_WIDTH;
+		auto pairs = std::vector<std::pair<int, int>>();
+		for (int i = 0; i < 100; ++i)
+			pairs.push_back({ i * 7919 % num_vertices, i * 104729 % num_vertices });
+
+		benchmark.run("dijkstra", name, "sssp_dijkstra", [&] {
+			harness::sink = dijkstra(num_vertices, sources[0], edges).back();
+		});
+		benchmark.run("dijkstra", name, "sssp_delta_stepping", [&] {
+			harness::sink = delta_stepping(num_vertices, sources[0], edges, average_edge_weight(edges), num_threads).back();
+		});
+		benchmark.run("dijkstra", name, "sweep8_dijkstra", [&] {
+			for (auto source : sources)
+				harness::sink = dijkstra(num_vertices, source, edges).back();
+		});
+		benchmark.run("dijkstra", name, "sweep8_batch", [&] {
+			harness::sink = dijkstra_batch(num_vertices, sources, edges).back()[0];
+		});
+
+		benchmark.run("dijkstra", name, "p2p100_early_exit", [&] {
+			for (auto [source, target] : pairs)
+				harness::sink = dijkstra_to(num_vertices, source, target, edges);
+		});
+
+		auto queries = PointToPoint(edges);
+		benchmark.run("dijkstra", name, "p2p100_bidirectional", [&] {
+			for (auto [source, target] : pairs)
+				harness::sink = queries.bidirectional(source, target);
+		});
+
+		// the file is removed before and after, so it never holds landmarks of another graph and needs no graph hash.
+		auto landmark_file = name + ".benchmark.landmarks";
+		std::remove(landmark_file.c_str());
+		benchmark.run("dijkstra", name, "alt_preprocess", 0, 1, [&] {
+			queries.prepare_landmarks(landmark_file, 16, 0);
+		});
+		benchmark.run("dijkstra", name, "p2p100_alt", [&] {
+			for (auto [source, target] : pairs)
+				harness::sink = queries.astar(source, target);
+		});
+		std::remove(landmark_file.c_str());
+
+		auto hierarchy = ContractionHierarchy();
+		benchmark.run("dijkstra", name, "ch_preprocess", 0, 1, [&] {
+			hierarchy = ContractionHierarchy(edges, num_threads);
+		});
+		benchmark.run("dijkstra", name, "p2p100_ch", [&] {
+			for (auto [source, target] : pairs)
+				harness::sink = hierarchy.distance(source, target);
+		});
+
+		auto text_file = name + ".benchmark.graph";
+		auto binary_file = name + ".benchmark.csr";
+		generator::write_graph(edges, text_file);
+		auto external = ExternalCsrGraph();
+		// converted right before it is opened, so like the landmark file it needs no graph hash.
+		if (ExternalCsrGraph::convert(text_file, binary_file, num_vertices, 4096, 0) && external.open(binary_file, num_vertices, 0))
+		{
+			auto failed = false;
+			benchmark.run("dijkstra", name, "sssp_external", [&] {
+				auto path_weight = external_dijkstra(external, sources[0]);
+				failed = failed || !path_weight;
+				harness::sink = path_weight ? path_weight->back() : INFINITE;
+			});
+			if (failed)
+				std::cout << "dijkstra / " << name << " / sssp_external : can't read partitions of " << binary_file << std::endl;
+		}
+		else
+		{
+			std::cout << "dijkstra / " << name << " / sssp_external : skipped, can't convert " << text_file << std::endl;
+		}
+		std::remove(text_file.c_str());
+		std::remove(binary_file.c_str());
+	}
+}
+
+// usage : Benchmark [output file] [repetitions] [warmup]
+// defaults : benchmark.json 5 1
+int main(int argc, char* argv[])
+{
+	auto output_file = std::string(argc > 1 ? argv[1] : "benchmark.json");
+	auto repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+	auto warmup = argc > 3 ? std::atoi(argv[3]) : 1;
+
+	auto benchmark = harness::Benchmark(warmup, repetitions);
+	benchmark_tsp(benchmark);
+	benchmark_knapsack(benchmark);
+	benchmark_dijkstra(benchmark);
+
+	benchmark.write_json(output_file);
+	std::cout << "results written to " << output_file << std::endl;
+}
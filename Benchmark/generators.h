@@ -0,0 +1,124 @@
+#pragma once
+#include <random>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include "tsp.h"
+#include "tsp_portfolio.h"
+#include "knapsack.h"
+#include "dijkstra.h"
+#include "point_to_point.h"
+#include "contraction_hierarchy.h"
+#include "external_graph.h"
+
+// Seeded synthetic instances for each solver.
+// Same arguments always produce the same instance, so measurements are comparable between runs.
+namespace generator
+{
+// Cities scattered uniformly on a 1000 x 1000 square.
+std::vector<tsp::City> uniform_cities(int count, unsigned seed)
+{
+	auto engine = std::mt19937(seed);
+	auto coordinate = std::uniform_real_distribution<double>(0.0, 1000.0);
+
+	auto cities = std::vector<tsp::City>(count);
+	for (int id = 0; id < count; ++id)
+		cities[id] = { id, coordinate(engine), coordinate(engine) };
+	return cities;
+}
+
+// Cities gathered around num_clusters centers with normal distribution,
+// which is closer to real maps and harder for simple swap-based local search.
+std::vector<tsp::City> clustered_cities(int count, int num_clusters, unsigned seed)
+{
+	auto engine = std::mt19937(seed);
+	auto coordinate = std::uniform_real_distribution<double>(0.0, 1000.0);
+	auto offset = std::normal_distribution<double>(0.0, 30.0);
+
+	auto centers = std::vector<std::pair<double, double>>(num_clusters);
+	for (auto& [x, y] : centers)
+	{
+		x = coordinate(engine);
+		y = coordinate(engine);
+	}
+
+	auto cities = std::vector<tsp::City>(count);
+	for (int id = 0; id < count; ++id)
+	{
+		auto [x, y] = centers[id % num_clusters];
+		cities[id] = { id, x + offset(engine), y + offset(engine) };
+	}
+	return cities;
+}
+
+// Items whose value is correlated with weight (value = weight + small noise),
+// which is known to be harder than independent weight and value.
+// Raw values follow the .kp file scale (real numbers below 1) and are converted with amplifier like knapsack::parse_file().
+std::vector<knapsack::Item> correlated_items(int count, int amplifier, unsigned seed)
+{
+	auto engine = std::mt19937(seed);
+	auto weight = std::uniform_real_distribution<double>(0.01, 0.3);
+	auto noise = std::uniform_real_distribution<double>(-0.05, 0.05);
+
+	auto items = std::vector<knapsack::Item>(count);
+	for (auto& item : items)
+	{
+		auto real_weight = weight(engine);
+		auto real_value = std::max(0.001, real_weight + noise(engine));
+		item = { (int)std::round(real_weight * amplifier), (int)std::round(real_value * amplifier) };
+	}
+	return items;
+}
+
+// Directed graph where each vertex has "degree" outgoing edges to random vertices, weights in [1, max_weight].
+std::vector<std::vector<shortest_path::Edge>> random_graph(int num_vertices, int degree, int max_weight, unsigned seed)
+{
+	auto engine = std::mt19937(seed);
+	auto vertex = std::uniform_int_distribution<int>(0, num_vertices - 1);
+	auto weight = std::uniform_int_distribution<int>(1, max_weight);
+
+	auto edges = std::vector<std::vector<shortest_path::Edge>>(num_vertices);
+	for (auto& outgoing : edges)
+		for (int i = 0; i < degree; ++i)
+			outgoing.push_back({ vertex(engine), weight(engine) });
+	return edges;
+}
+
+// width x height grid where each cell is connected to its four neighbors in both directions,
+// weights in [1, max_weight]. Similar to road networks in that shortest paths are long and local.
+std::vector<std::vector<shortest_path::Edge>> grid_graph(int width, int height, int max_weight, unsigned seed)
+{
+	auto engine = std::mt19937(seed);
+	auto weight = std::uniform_int_distribution<int>(1, max_weight);
+
+	auto edges = std::vector<std::vector<shortest_path::Edge>>(width * height);
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			auto from = y * width + x;
+			if (x + 1 < width)
+			{
+				edges[from].push_back({ from + 1, weight(engine) });
+				edges[from + 1].push_back({ from, weight(engine) });
+			}
+			if (y + 1 < height)
+			{
+				edges[from].push_back({ from + width, weight(engine) });
+				edges[from + width].push_back({ from, weight(engine) });
+			}
+		}
+	}
+	return edges;
+}
+
+// Write graph in .graph text format ("[from] [to] [weight]" per line).
+void write_graph(const std::vector<std::vector<shortest_path::Edge>>& edges, const std::string& file_name)
+{
+	auto output = std::ofstream(file_name);
+	for (size_t from = 0; from < edges.size(); ++from)
+		for (const auto& [to, weight] : edges[from])
+			output << from << " " << to << " " << weight << "\n";
+}
+}
@@ -0,0 +1,168 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+
+namespace harness
+{
+// Updated by the replaced global operator new and delete in benchmark.cpp.
+extern std::atomic<std::uint64_t> allocation_count;
+extern std::atomic<std::uint64_t> allocated_bytes;
+// Bytes currently allocated, and the largest value since Benchmark last reset it.
+extern std::atomic<std::uint64_t> live_bytes;
+extern std::atomic<std::uint64_t> peak_live_bytes;
+
+inline void record_allocation(std::size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	auto live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+	auto peak = peak_live_bytes.load(std::memory_order_relaxed);
+	while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		;
+}
+
+inline void record_deallocation(std::size_t size)
+{
+	live_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+// Solvers store their result here so that the compiler can't drop the work as unused.
+inline volatile std::int64_t sink = 0;
+
+// Discards everything written to it.
+// Several solvers print progress, which would otherwise dominate the measurement.
+class NullBuffer : public std::streambuf
+{
+protected:
+	int overflow(int c) override
+	{
+		return c;
+	}
+};
+
+struct Measurement
+{
+	std::string problem;
+	std::string instance;
+	std::string solver;
+	int repetitions;
+	double median_ms;
+	double p95_ms;
+	double min_ms;
+	double max_ms;
+	std::uint64_t allocations_per_run;
+	std::uint64_t allocated_bytes_per_run;
+	// Largest growth of the heap over its size before the measured runs, in KB.
+	// Unlike the peak RSS of the process, which only grows, this covers the task alone.
+	// Memory mapped files and thread stacks are not included.
+	std::uint64_t peak_heap_kb;
+};
+
+// Runs each task "warmup" times without recording, then "repetitions" times with timing and allocation counting.
+// Results are printed as they come and can be written as JSON at the end.
+class Benchmark
+{
+public:
+	Benchmark(int warmup, int repetitions)
+		: warmup(warmup), repetitions(repetitions)
+	{}
+
+	void run(const std::string& problem, const std::string& instance, const std::string& solver, const std::function<void()>& task)
+	{
+		run(problem, instance, solver, warmup, repetitions, task);
+	}
+
+	// Same as above with explicit counts, for expensive one-off tasks such as preprocessing.
+	// At least one repetition is always measured.
+	void run(const std::string& problem, const std::string& instance, const std::string& solver, int warmup, int repetitions, const std::function<void()>& task)
+	{
+		repetitions = std::max(1, repetitions);
+		auto null_buffer = NullBuffer();
+		auto original_buffer = std::cout.rdbuf(&null_buffer);
+
+		for (int i = 0; i < warmup; ++i)
+			task();
+
+		auto durations = std::vector<double>();
+		durations.reserve(repetitions);
+		auto start_count = allocation_count.load();
+		auto start_bytes = allocated_bytes.load();
+		auto start_live = live_bytes.load();
+		peak_live_bytes.store(start_live);
+		for (int i = 0; i < repetitions; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			task();
+			auto end = std::chrono::steady_clock::now();
+			durations.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		auto count = (allocation_count.load() - start_count) / repetitions;
+		auto bytes = (allocated_bytes.load() - start_bytes) / repetitions;
+		auto peak_heap = peak_live_bytes.load() - start_live;
+
+		std::cout.rdbuf(original_buffer);
+
+		std::sort(durations.begin(), durations.end());
+		auto percentile = [&](double ratio) {
+			auto index = static_cast<size_t>(std::ceil(ratio * durations.size())) - 1;
+			return durations[std::min(index, durations.size() - 1)];
+		};
+
+		auto result = Measurement{
+			problem, instance, solver, repetitions,
+			percentile(0.5), percentile(0.95), durations.front(), durations.back(),
+			count, bytes, peak_heap / 1024
+		};
+		print(result);
+		results.push_back(result);
+	}
+
+	// All measurements as a JSON array of objects, one object per line.
+	void write_json(const std::string& file_name) const
+	{
+		auto output = std::ofstream(file_name);
+		output << "[\n";
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& result = results[i];
+			output << "  {"
+				<< "\"problem\": \"" << result.problem << "\", "
+				<< "\"instance\": \"" << result.instance << "\", "
+				<< "\"solver\": \"" << result.solver << "\", "
+				<< "\"repetitions\": " << result.repetitions << ", "
+				<< "\"median_ms\": " << result.median_ms << ", "
+				<< "\"p95_ms\": " << result.p95_ms << ", "
+				<< "\"min_ms\": " << result.min_ms << ", "
+				<< "\"max_ms\": " << result.max_ms << ", "
+				<< "\"allocations_per_run\": " << result.allocations_per_run << ", "
+				<< "\"allocated_bytes_per_run\": " << result.allocated_bytes_per_run << ", "
+				<< "\"peak_heap_kb\": " << result.peak_heap_kb
+				<< "}" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		output << "]\n";
+	}
+
+private:
+	static void print(const Measurement& result)
+	{
+		std::cout << result.problem << " / " << result.instance << " / " << result.solver << " : "
+			<< "median " << result.median_ms << " ms, "
+			<< "p95 " << result.p95_ms << " ms, "
+			<< result.allocations_per_run << " allocations ("
+			<< result.allocated_bytes_per_run / 1024 << " KB), "
+			<< "peak heap " << result.peak_heap_kb << " KB" << std::endl;
+	}
+
+	int warmup;
+	int repetitions;
+	std::vector<Measurement> results;
+};
+}